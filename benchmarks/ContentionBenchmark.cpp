@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "details/CacheLine.h"
+#include "details/PoolAllocator.h"
+#include "details/RemoteQueue.h"
+#include "details/WorkStealingDeque.h"
+
+// Measures the owner side of structures that other threads write to concurrently, so false sharing between the shared
+// atomics and the owner's own state shows up as owner time. The first rows isolate the effect with two counters that
+// do or do not share a cache line. Needs at least two cores to show anything.
+
+namespace
+{
+	using namespace TKit;
+
+	// Up to three threads besides the owner, fewer when the cores would be oversubscribed.
+	const std::size_t OtherThreadCount = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 2, 4) - 1;
+
+	struct PackedCounters
+	{
+		std::atomic<std::size_t> owner{0};
+		std::atomic<std::size_t> other{0};
+	};
+
+	struct PaddedCounters
+	{
+		alignas(Details::CacheLineSize) std::atomic<std::size_t> owner{0};
+		alignas(Details::CacheLineSize) std::atomic<std::size_t> other{0};
+	};
+
+	// Runs otherFunc on OtherThreadCount threads until ownerFunc returns, and reports the owner's time per operation.
+	template<typename OwnerFunc, typename OtherFunc>
+	double MeasureOwnerNanoseconds(std::size_t operationCount, OwnerFunc&& ownerFunc, OtherFunc&& otherFunc)
+	{
+		std::atomic<bool> running{true};
+		std::atomic<std::size_t> readyCount{0};
+		std::vector<std::thread> others;
+		for (std::size_t i = 0; i < OtherThreadCount; ++i)
+		{
+			others.emplace_back([&]()
+			{
+				readyCount.fetch_add(1, std::memory_order_release);
+				while (running.load(std::memory_order_relaxed))
+				{
+					otherFunc();
+				}
+			});
+		}
+		while (readyCount.load(std::memory_order_acquire) < OtherThreadCount)
+		{
+			std::this_thread::yield();
+		}
+
+		const auto begin = std::chrono::steady_clock::now();
+		ownerFunc();
+		const auto end = std::chrono::steady_clock::now();
+
+		running.store(false, std::memory_order_relaxed);
+		for (auto& other : others)
+		{
+			other.join();
+		}
+		return std::chrono::duration<double, std::nano>(end - begin).count() / static_cast<double>(operationCount);
+	}
+
+	template<typename Counters>
+	double MeasureCounters(std::size_t operationCount)
+	{
+		Counters counters;
+		return MeasureOwnerNanoseconds(operationCount, [&]()
+		{
+			for (std::size_t i = 0; i < operationCount; ++i)
+			{
+				counters.owner.store(counters.owner.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+		}, [&]()
+		{
+			counters.other.fetch_add(1, std::memory_order_relaxed);
+		});
+	}
+
+	// Producers keep pushing while the owner drains, as other threads do with a scheduler's remote queue. Entries in
+	// flight are capped below the ring size so that the overflow list is never allocated; the owner's count is of
+	// drain calls, whether or not they find entries.
+	double MeasureRemoteQueue(std::size_t operationCount)
+	{
+		constexpr std::size_t capacity = 1024;
+		RemoteQueue<std::size_t> queue(capacity);
+		std::atomic<std::size_t> inFlight{0};
+		return MeasureOwnerNanoseconds(operationCount, [&]()
+		{
+			for (std::size_t i = 0; i < operationCount; ++i)
+			{
+				if (const std::size_t count = queue.Drain([](std::size_t) {}); count > 0)
+				{
+					inFlight.fetch_sub(count, std::memory_order_relaxed);
+				}
+			}
+		}, [&]()
+		{
+			if (inFlight.load(std::memory_order_relaxed) < capacity / 2)
+			{
+				inFlight.fetch_add(1, std::memory_order_relaxed);
+				queue.Push(1);
+			}
+		});
+	}
+
+	// Thieves poll an almost empty deque while its owner pushes and pops, as idle workers do.
+	double MeasureWorkStealingDeque(std::size_t operationCount)
+	{
+		WorkStealingDeque deque(256);
+		static int frame = 0;
+		const auto handle = std::coroutine_handle<>::from_address(&frame);
+		return MeasureOwnerNanoseconds(operationCount, [&]()
+		{
+			for (std::size_t i = 0; i < operationCount; ++i)
+			{
+				deque.Push(handle);
+				static_cast<void>(deque.Pop());
+			}
+		}, [&]()
+		{
+			static_cast<void>(deque.GetApproximateSize());
+			static_cast<void>(deque.Steal());
+		});
+	}
+
+	// The owner allocates and frees frames locally and hands every eighth one to other threads, which free it remotely.
+	double MeasurePoolAllocator(std::size_t operationCount)
+	{
+		constexpr std::size_t frameSize = 256;
+		PoolAllocator allocator;
+		RemoteQueue<void*> handoff(4096);
+		const double result = MeasureOwnerNanoseconds(operationCount, [&]()
+		{
+			for (std::size_t i = 0; i < operationCount; ++i)
+			{
+				void* frame = allocator.Allocate(frameSize);
+				if (i % 8 == 0)
+				{
+					handoff.Push(frame);
+				}
+				else
+				{
+					allocator.Deallocate(frame, frameSize);
+				}
+			}
+		}, [&]()
+		{
+			handoff.Drain([&allocator](void* frame) { allocator.Deallocate(frame, frameSize); });
+			allocator.FlushRemoteFrees();
+		});
+		handoff.Drain([&allocator](void* frame) { allocator.Deallocate(frame, frameSize); });
+		return result;
+	}
+}
+
+int main()
+{
+	constexpr std::size_t operationCount = 1 << 21;
+
+	std::printf("cache line %zu bytes, %zu other threads, %u hardware threads\n",
+		Details::CacheLineSize, OtherThreadCount, std::thread::hardware_concurrency());
+	std::printf("%-24s %10s\n", "owner operation", "ns/op");
+	std::printf("%-24s %10.2f\n", "counter (shared line)", MeasureCounters<PackedCounters>(operationCount));
+	std::printf("%-24s %10.2f\n", "counter (own line)", MeasureCounters<PaddedCounters>(operationCount));
+	std::printf("%-24s %10.2f\n", "remote queue drain", MeasureRemoteQueue(operationCount));
+	std::printf("%-24s %10.2f\n", "deque push + pop", MeasureWorkStealingDeque(operationCount));
+	std::printf("%-24s %10.2f\n", "pool allocate + free", MeasurePoolAllocator(operationCount));
+
+	return 0;
+}
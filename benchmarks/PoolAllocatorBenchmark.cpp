@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "TaskKit.h"
+
+// Records the coroutine frame sizes of a mixed TaskKit workload, then replays them against the PoolAllocator.
+// Reports the bytes each frame occupies under the current size classes and under the previous coarse table with its
+// per-block header and under classes fitted to the recorded sizes, and the latency of the size-class lookup and of an allocate/deallocate pair.
+
+namespace
+{
+	using namespace TKit;
+
+	constexpr std::array<std::size_t, 9> PreviousPoolSizes = {
+		48, 64, 128, 256, 512, 1024, 2048, 4096, 8192
+	};
+
+	// Blocks used to carry an owner/class header; slab headers replaced it.
+	constexpr std::size_t PreviousBlockMetaSize = alignof(std::max_align_t);
+
+	std::vector<std::size_t> recordedSizes;
+
+	int FindPreviousPoolIndex(std::size_t size)
+	{
+		for (int i = 0; i < static_cast<int>(PreviousPoolSizes.size()); ++i)
+		{
+			if (size <= PreviousPoolSizes[i])
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	template<typename Sizes>
+	std::size_t GetFootprint(std::size_t size, const Sizes& sizes, int index, std::size_t metaSize)
+	{
+		return (index >= 0 ? sizes[index] : size) + metaSize;
+	}
+
+	Task<int> Leaf(int value)
+	{
+		co_await DelayFrame(1);
+		co_return value;
+	}
+
+	Task<std::string> Format(int value)
+	{
+		const int result = co_await Leaf(value);
+		co_return std::to_string(result);
+	}
+
+	Task<> Batch(int width)
+	{
+		std::vector<Task<int>> tasks;
+		for (int i = 0; i < width; ++i)
+		{
+			tasks.push_back(Leaf(i));
+		}
+		static_cast<void>(co_await WhenAll(std::move(tasks)));
+		static_cast<void>(co_await WhenAny(Leaf(1), Format(2)));
+		static_cast<void>(co_await WhenAll(Format(3), Leaf(4)));
+		co_await WaitFor(std::chrono::nanoseconds::zero());
+	}
+
+	std::vector<std::size_t> RecordFrameSizes()
+	{
+		TaskAllocator recorder{
+			nullptr,
+			[](void*, std::size_t size) -> void*
+			{
+				recordedSizes.push_back(size);
+				return ::operator new(size);
+			},
+			[](void*, void* ptr, std::size_t size)
+			{
+				::operator delete(ptr, size);
+			}
+		};
+
+		TaskSystem::Initialize(TaskSystemConfiguration::Builder().WithCustomAllocator(recorder).Build());
+		{
+			const auto schedulerId = TaskSystem::CreateScheduler();
+			const auto activation = TaskSystem::ActivateScheduler(schedulerId);
+
+			for (int width = 1; width <= 16; ++width)
+			{
+				Batch(width).Forget();
+			}
+			while (TaskSystem::GetPendingTaskCount(schedulerId) > 0)
+			{
+				TaskSystem::UpdateActivatedScheduler();
+			}
+		}
+		TaskSystem::Shutdown();
+
+		return std::move(recordedSizes);
+	}
+
+	template<typename Func>
+	double MeasureNanoseconds(std::size_t operationCount, Func&& func)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+		func();
+		const auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - begin).count() / static_cast<double>(operationCount);
+	}
+}
+
+int main()
+{
+	const std::vector<std::size_t> frameSizes = RecordFrameSizes();
+
+	PoolAllocator profiler(PoolAllocatorConfiguration::Builder().WithSizeHistogram().Build());
+	for (const std::size_t size : frameSizes)
+	{
+		profiler.Deallocate(profiler.Allocate(size), size);
+	}
+	PoolAllocator fitted(PoolAllocatorConfiguration::Builder()
+		.WithSizeClasses(PoolAllocator::FitSizeClasses(profiler.GetSizeHistogram()))
+		.Build());
+
+	std::size_t previousBytes = 0;
+	std::size_t currentBytes = 0;
+	std::size_t fittedBytes = 0;
+	for (const std::size_t size : frameSizes)
+	{
+		previousBytes += GetFootprint(size, PreviousPoolSizes, FindPreviousPoolIndex(size), PreviousBlockMetaSize);
+		currentBytes += GetFootprint(size, PoolAllocator::PoolSizes, PoolAllocator::FindPoolIndex(size), 0);
+		fittedBytes += GetFootprint(size, fitted.GetPoolSizes(), fitted.GetPoolIndex(size), 0);
+	}
+
+	const auto [smallest, largest] = std::minmax_element(frameSizes.begin(), frameSizes.end());
+	std::printf("recorded %zu frames, %zu..%zu bytes\n", frameSizes.size(), *smallest, *largest);
+	std::printf("%-10s %14s %14s\n", "classes", "bytes/frame", "total bytes");
+	std::printf("%-10s %14.1f %14zu\n", "previous", static_cast<double>(previousBytes) / frameSizes.size(), previousBytes);
+	std::printf("%-10s %14.1f %14zu\n", "current", static_cast<double>(currentBytes) / frameSizes.size(), currentBytes);
+	std::printf("%-10s %14.1f %14zu\n", "fitted", static_cast<double>(fittedBytes) / frameSizes.size(), fittedBytes);
+	std::printf("saved %.1f%%\n\n", 100.0 * static_cast<double>(previousBytes - currentBytes) / static_cast<double>(previousBytes));
+
+	// Replay the distribution in a shuffled order so the lookup cannot be predicted from the previous size.
+	constexpr std::size_t replayCount = 1 << 20;
+	std::vector<std::size_t> replay(replayCount);
+	std::mt19937 random(12345);
+	std::uniform_int_distribution<std::size_t> pick(0, frameSizes.size() - 1);
+	for (std::size_t& size : replay)
+	{
+		size = frameSizes[pick(random)];
+	}
+
+	constexpr int rounds = 20;
+	volatile int sink = 0;
+
+	const double previousLookup = MeasureNanoseconds(replayCount * rounds, [&]()
+	{
+		for (int round = 0; round < rounds; ++round)
+		{
+			for (const std::size_t size : replay)
+			{
+				sink = sink + FindPreviousPoolIndex(size);
+			}
+		}
+	});
+
+	const double currentLookup = MeasureNanoseconds(replayCount * rounds, [&]()
+	{
+		for (int round = 0; round < rounds; ++round)
+		{
+			for (const std::size_t size : replay)
+			{
+				sink = sink + PoolAllocator::FindPoolIndex(size);
+			}
+		}
+	});
+
+	PoolAllocator allocator;
+	constexpr std::size_t liveFrames = 256;
+	std::vector<void*> frames(liveFrames);
+
+	const double allocation = MeasureNanoseconds(replayCount, [&]()
+	{
+		for (std::size_t i = 0; i < replayCount; i += liveFrames)
+		{
+			for (std::size_t j = 0; j < liveFrames; ++j)
+			{
+				frames[j] = allocator.Allocate(replay[i + j]);
+			}
+			for (std::size_t j = 0; j < liveFrames; ++j)
+			{
+				allocator.Deallocate(frames[j], replay[i + j]);
+			}
+		}
+	});
+
+	// Every batch stands in for one scheduler update whose frames all finish before it ends.
+	FrameArenaAllocator arena(allocator.CreateTaskAllocator());
+	const double arenaAllocation = MeasureNanoseconds(replayCount, [&]()
+	{
+		for (std::size_t i = 0; i < replayCount; i += liveFrames)
+		{
+			for (std::size_t j = 0; j < liveFrames; ++j)
+			{
+				frames[j] = arena.Allocate(replay[i + j]);
+			}
+			for (std::size_t j = 0; j < liveFrames; ++j)
+			{
+				arena.Deallocate(frames[j], replay[i + j]);
+			}
+			arena.EndFrame();
+		}
+	});
+
+	// A per-level allocator and a global one used in turn by the same thread.
+	PoolAllocator otherAllocator;
+	const double alternatingAllocation = MeasureNanoseconds(replayCount, [&]()
+	{
+		for (std::size_t i = 0; i < replayCount; i += liveFrames)
+		{
+			for (std::size_t j = 0; j < liveFrames; ++j)
+			{
+				frames[j] = (j % 2 ? otherAllocator : allocator).Allocate(replay[i + j]);
+			}
+			for (std::size_t j = 0; j < liveFrames; ++j)
+			{
+				(j % 2 ? otherAllocator : allocator).Deallocate(frames[j], replay[i + j]);
+			}
+		}
+	});
+
+	// A budget far above the replay's footprint, so only the accounting shows.
+	PoolAllocator budgetedAllocator(PoolAllocatorConfiguration::Builder().WithMemoryBudget(64 * 1024 * 1024).Build());
+	const double budgetedAllocation = MeasureNanoseconds(replayCount, [&]()
+	{
+		for (std::size_t i = 0; i < replayCount; i += liveFrames)
+		{
+			for (std::size_t j = 0; j < liveFrames; ++j)
+			{
+				frames[j] = budgetedAllocator.Allocate(replay[i + j]);
+			}
+			for (std::size_t j = 0; j < liveFrames; ++j)
+			{
+				budgetedAllocator.Deallocate(frames[j], replay[i + j]);
+			}
+		}
+	});
+
+	std::printf("%-24s %10s\n", "operation", "ns/op");
+	std::printf("%-24s %10.2f\n", "lookup (linear scan)", previousLookup);
+	std::printf("%-24s %10.2f\n", "lookup (table)", currentLookup);
+	std::printf("%-24s %10.2f\n", "allocate + deallocate", allocation);
+	std::printf("%-24s %10.2f\n", "with memory budget", budgetedAllocation);
+	std::printf("%-24s %10.2f\n", "alternating allocators", alternatingAllocation);
+	std::printf("%-24s %10.2f\n", "frame arena", arenaAllocation);
+
+	return 0;
+}
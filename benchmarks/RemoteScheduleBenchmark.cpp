@@ -0,0 +1,144 @@
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <new>
+#include <thread>
+#include <vector>
+#include "details/TaskScheduler.h"
+
+// Measures cross-thread TaskScheduler::Schedule: producer threads hand a coroutine to a scheduler owned by the main thread.
+// In-flight handoffs are capped like live tasks would cap them, and every global allocation made while measuring is counted.
+
+namespace
+{
+	std::atomic<std::size_t> allocationCount{0};
+}
+
+void* operator new(std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* pointer = std::malloc(size == 0 ? 1 : size))
+	{
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+namespace
+{
+	struct Counter
+	{
+		struct promise_type
+		{
+			Counter get_return_object() { return Counter{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			std::suspend_always final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { std::terminate(); }
+		};
+
+		std::coroutine_handle<promise_type> handle;
+	};
+
+	// Each resume retires one handoff; the same suspended frame can be queued any number of times.
+	Counter CountHandoffs(std::atomic<std::size_t>& inFlight)
+	{
+		while (true)
+		{
+			inFlight.fetch_sub(1, std::memory_order_relaxed);
+			co_await std::suspend_always{};
+		}
+	}
+
+	struct Result
+	{
+		double nanosecondsPerHandoff;
+		std::size_t allocations;
+	};
+
+	Result Run(std::size_t producerCount, std::size_t handoffsPerProducer, std::size_t maxInFlight)
+	{
+		TKit::TaskScheduler scheduler(100);
+		std::atomic<std::size_t> inFlight{0};
+		const Counter counter = CountHandoffs(inFlight);
+
+		std::vector<std::thread> producers;
+		producers.reserve(producerCount);
+		std::atomic<bool> start{false};
+		std::atomic<std::size_t> finishedProducers{0};
+
+		for (std::size_t i = 0; i < producerCount; ++i)
+		{
+			producers.emplace_back([&]()
+			{
+				while (!start.load(std::memory_order_acquire))
+				{
+					std::this_thread::yield();
+				}
+				for (std::size_t n = 0; n < handoffsPerProducer; ++n)
+				{
+					while (inFlight.load(std::memory_order_relaxed) >= maxInFlight)
+					{
+						std::this_thread::yield();
+					}
+					inFlight.fetch_add(1, std::memory_order_relaxed);
+					scheduler.Schedule(counter.handle);
+				}
+				finishedProducers.fetch_add(1, std::memory_order_release);
+			});
+		}
+
+		const std::size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+		const auto begin = std::chrono::steady_clock::now();
+		start.store(true, std::memory_order_release);
+
+		while (finishedProducers.load(std::memory_order_acquire) < producerCount || scheduler.GetPendingTaskCount() > 0)
+		{
+			scheduler.Update();
+			if (scheduler.GetPendingTaskCount() == 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		const auto end = std::chrono::steady_clock::now();
+		const std::size_t allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+		for (auto& producer : producers)
+		{
+			producer.join();
+		}
+		counter.handle.destroy();
+
+		const auto elapsed = std::chrono::duration<double, std::nano>(end - begin).count();
+		return { elapsed / static_cast<double>(producerCount * handoffsPerProducer), allocations };
+	}
+}
+
+int main()
+{
+	constexpr std::size_t handoffsPerProducer = 1'000'000;
+	constexpr std::size_t maxInFlight = 64;
+
+	std::printf("%-10s %14s %14s\n", "producers", "ns/handoff", "allocations");
+	for (const std::size_t producerCount : { std::size_t{1}, std::size_t{2}, std::size_t{4} })
+	{
+		const Result result = Run(producerCount, handoffsPerProducer, maxInFlight);
+		std::printf("%-10zu %14.1f %14zu\n", producerCount, result.nanosecondsPerHandoff, result.allocations);
+	}
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+#define TASKKIT_ALLOCATOR ::TKit::PoolAllocatorPolicy
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "TaskKit.h"
+
+// Compares the frame allocation path bound at compile time through TASKKIT_ALLOCATOR with the run-time TaskAllocator
+// indirection over the same pool, first on raw allocate/deallocate pairs and then on tasks spawned and run to completion.
+
+namespace
+{
+	using namespace TKit;
+
+	template<typename Func>
+	double MeasureNanoseconds(std::size_t operationCount, Func&& func)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+		func();
+		const auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - begin).count() / static_cast<double>(operationCount);
+	}
+
+	Task<int> Leaf(int value)
+	{
+		co_return value;
+	}
+
+	Task<> Spawn(int& sum)
+	{
+		sum += co_await Leaf(1);
+	}
+}
+
+int main()
+{
+	constexpr std::size_t operationCount = 1 << 22;
+	constexpr std::size_t liveFrames = 64;
+	constexpr std::size_t frameSize = 160;
+	std::vector<void*> frames(liveFrames);
+
+	const TaskAllocator dynamicAllocator = PoolAllocatorPolicy::GetPoolAllocator().CreateTaskAllocator();
+	const double dynamicPath = MeasureNanoseconds(operationCount, [&]()
+	{
+		for (std::size_t i = 0; i < operationCount; i += liveFrames)
+		{
+			for (void*& frame : frames)
+			{
+				frame = dynamicAllocator.Allocate(frameSize);
+			}
+			for (void* frame : frames)
+			{
+				dynamicAllocator.Deallocate(frame, frameSize);
+			}
+		}
+	});
+
+	const double staticPath = MeasureNanoseconds(operationCount, [&]()
+	{
+		for (std::size_t i = 0; i < operationCount; i += liveFrames)
+		{
+			for (void*& frame : frames)
+			{
+				frame = TaskAllocatorPolicy::Allocate(frameSize);
+			}
+			for (void* frame : frames)
+			{
+				TaskAllocatorPolicy::Deallocate(frame, frameSize);
+			}
+		}
+	});
+
+	constexpr int taskCount = 1 << 20;
+	int sum = 0;
+	TaskSystem::Initialize();
+	const double taskPath = MeasureNanoseconds(taskCount, [&]()
+	{
+		for (int i = 0; i < taskCount; ++i)
+		{
+			Spawn(sum).Forget();
+		}
+	});
+	TaskSystem::Shutdown();
+
+	std::printf("%-28s %10s\n", "operation", "ns/op");
+	std::printf("%-28s %10.2f\n", "TaskAllocator (indirect)", dynamicPath);
+	std::printf("%-28s %10.2f\n", "TASKKIT_ALLOCATOR (inlined)", staticPath);
+	std::printf("%-28s %10.2f\n", "task spawn + completion", taskPath);
+	return sum == taskCount ? 0 : 1;
+}
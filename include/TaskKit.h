@@ -3,7 +3,12 @@
 
 #include "details/Exceptions.h"
 #include "details/TaskAllocator.h"
+#include "details/FrameArenaAllocator.h"
 #include "details/PoolAllocator.h"
+#include "details/PoolAllocatorConfiguration.h"
+#include "details/PoolMemoryResource.h"
+#include "details/TaskAllocatorPolicy.h"
+#include "details/TaskPriority.h"
 #include "details/TaskScheduler.h"
 #include "details/TaskSystem.h"
 #include "details/TaskSystemConfiguration.h"
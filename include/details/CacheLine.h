@@ -0,0 +1,23 @@
+#ifndef TASKKIT_CACHE_LINE_H
+#define TASKKIT_CACHE_LINE_H
+
+#include <cstddef>
+#include <new>
+
+// Padding between atomics written by different threads. GCC and Clang let std::hardware_destructive_interference_size
+// follow -mtune, which would give the same header different layouts across translation units, so they get a fixed
+// value; define this to match the target, e.g. 128 on Apple silicon.
+#ifndef TASKKIT_CACHE_LINE_SIZE
+#if defined(__cpp_lib_hardware_interference_size) && !defined(__GNUC__)
+#define TASKKIT_CACHE_LINE_SIZE std::hardware_destructive_interference_size
+#else
+#define TASKKIT_CACHE_LINE_SIZE 64
+#endif
+#endif
+
+namespace TKit::Details
+{
+	inline constexpr std::size_t CacheLineSize = TASKKIT_CACHE_LINE_SIZE;
+}
+
+#endif //TASKKIT_CACHE_LINE_H
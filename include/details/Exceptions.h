@@ -1,6 +1,8 @@
 ﻿#ifndef TASKKIT_EXCEPTIONS_H
 #define TASKKIT_EXCEPTIONS_H
+#include <cstddef>
 #include <format>
+#include <string>
 #include <utility>
 
 namespace TKit
@@ -30,6 +32,16 @@ namespace TKit
 		{
 		}
 	};
+
+	class MemoryBudgetExceededError final : public TaskKitError
+	{
+	public:
+		MemoryBudgetExceededError(std::size_t requestedBytes, std::size_t usedBytes, std::size_t budget) :
+			TaskKitError("Allocating " + std::to_string(requestedBytes) + " bytes would exceed the memory budget: " +
+				std::to_string(usedBytes) + " of " + std::to_string(budget) + " bytes in use")
+		{
+		}
+	};
 }
 
 #endif //TASKKIT_EXCEPTIONS_H
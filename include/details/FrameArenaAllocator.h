@@ -0,0 +1,187 @@
+#ifndef TASKKIT_FRAME_ARENA_ALLOCATOR_H
+#define TASKKIT_FRAME_ARENA_ALLOCATOR_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <thread>
+#include "CacheLine.h"
+#include "TaskAllocator.h"
+
+namespace TKit
+{
+	// Bump-allocates coroutine frames created on the owner thread from a fixed set of chunks and rewinds a chunk in bulk
+	// at the end of a scheduler update once none of its frames is alive. Frames that outlive the update keep their chunk
+	// pinned and allocation moves on to a free one; when none is free, or the request comes from another thread or is
+	// larger than a chunk, the fallback allocator serves it.
+	class FrameArenaAllocator
+	{
+		// The owner counts its own allocations and frees without atomics; other threads only count what they free.
+		struct alignas(Details::CacheLineSize) Chunk
+		{
+			std::size_t liveCount = 0;
+			std::atomic<std::size_t> remoteFreeCount{0};
+
+			[[nodiscard]]
+			bool IsFree() const noexcept
+			{
+				return liveCount == remoteFreeCount.load(std::memory_order_acquire);
+			}
+
+			// Nothing is left for another thread to free, so the remote count can be cleared without racing it.
+			void Reset() noexcept
+			{
+				liveCount = 0;
+				remoteFreeCount.store(0, std::memory_order_relaxed);
+			}
+		};
+
+	public:
+		static constexpr std::size_t Alignment = alignof(std::max_align_t);
+
+		explicit FrameArenaAllocator(
+			const TaskAllocator& fallback,
+			std::size_t chunkSize = 64 * 1024,
+			std::size_t chunkCount = 4,
+			std::thread::id ownerId = std::thread::id{}
+		) :
+			fallback_(fallback),
+			ownerId_(ownerId == std::thread::id{} ? std::this_thread::get_id() : ownerId),
+			chunkSize_((chunkSize + Alignment - 1) & ~(Alignment - 1)),
+			chunkCount_(chunkCount),
+			chunks_(std::make_unique<Chunk[]>(chunkCount))
+		{
+			assert(chunkSize_ > 0 && chunkCount_ > 0 && "FrameArenaAllocator: arena must not be empty");
+			memory_ = static_cast<char*>(::operator new(chunkSize_ * chunkCount_, std::align_val_t{Alignment}));
+			cursor_ = memory_;
+			chunkEnd_ = memory_ + chunkSize_;
+		}
+
+		~FrameArenaAllocator()
+		{
+			::operator delete(memory_, std::align_val_t{Alignment});
+		}
+
+		void* Allocate(std::size_t size)
+		{
+			const std::size_t alignedSize = (size + Alignment - 1) & ~(Alignment - 1);
+			if (alignedSize > chunkSize_ || std::this_thread::get_id() != ownerId_)
+			{
+				return fallback_.Allocate(size);
+			}
+
+			if (static_cast<std::size_t>(chunkEnd_ - cursor_) < alignedSize && !MoveToFreeChunk())
+			{
+				return fallback_.Allocate(size);
+			}
+
+			void* ptr = cursor_;
+			cursor_ += alignedSize;
+			++chunks_[currentChunk_].liveCount;
+			return ptr;
+		}
+
+		// Safe from any thread; arena frames only update their chunk's counts.
+		void Deallocate(void* ptr, std::size_t size)
+		{
+			if (!ptr)
+			{
+				return;
+			}
+
+			if (!Owns(ptr))
+			{
+				fallback_.Deallocate(ptr, size);
+				return;
+			}
+
+			auto& chunk = chunks_[static_cast<std::size_t>(static_cast<char*>(ptr) - memory_) / chunkSize_];
+			if (std::this_thread::get_id() == ownerId_)
+			{
+				--chunk.liveCount;
+			}
+			else
+			{
+				chunk.remoteFreeCount.fetch_add(1, std::memory_order_release);
+			}
+		}
+
+		// Called by the scheduler at the end of each update. On the owner thread the current chunk starts over once all of
+		// its frames are gone; otherwise bumping carries on in it until it fills up.
+		void EndFrame()
+		{
+			if (std::this_thread::get_id() == ownerId_ && chunks_[currentChunk_].IsFree())
+			{
+				chunks_[currentChunk_].Reset();
+				cursor_ = chunkEnd_ - chunkSize_;
+			}
+			fallback_.Flush();
+		}
+
+		[[nodiscard]]
+		bool Owns(const void* ptr) const noexcept
+		{
+			const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+			const auto begin = reinterpret_cast<std::uintptr_t>(memory_);
+			return address >= begin && address < begin + chunkSize_ * chunkCount_;
+		}
+
+		TaskAllocator CreateTaskAllocator()
+		{
+			return TaskAllocator{
+				this,
+				[](void* context, std::size_t size) -> void* {
+					auto* allocator = static_cast<FrameArenaAllocator*>(context);
+					return allocator->Allocate(size);
+				},
+				[](void* context, void* ptr, std::size_t size) {
+					auto* allocator = static_cast<FrameArenaAllocator*>(context);
+					allocator->Deallocate(ptr, size);
+				},
+				[](void* context) {
+					auto* allocator = static_cast<FrameArenaAllocator*>(context);
+					allocator->EndFrame();
+				}
+			};
+		}
+
+		FrameArenaAllocator(const FrameArenaAllocator&) = delete;
+		FrameArenaAllocator& operator=(const FrameArenaAllocator&) = delete;
+		FrameArenaAllocator(FrameArenaAllocator&&) = delete;
+		FrameArenaAllocator& operator=(FrameArenaAllocator&&) = delete;
+
+	private:
+		// A chunk with no live frame can be rewound no matter how far it was bumped; the current one is tried last.
+		bool MoveToFreeChunk()
+		{
+			for (std::size_t offset = 1; offset <= chunkCount_; ++offset)
+			{
+				const std::size_t index = (currentChunk_ + offset) % chunkCount_;
+				if (chunks_[index].IsFree())
+				{
+					chunks_[index].Reset();
+					currentChunk_ = index;
+					cursor_ = memory_ + index * chunkSize_;
+					chunkEnd_ = cursor_ + chunkSize_;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		TaskAllocator fallback_;
+		std::thread::id ownerId_;
+		std::size_t chunkSize_;
+		std::size_t chunkCount_;
+		std::unique_ptr<Chunk[]> chunks_;
+		char* memory_ = nullptr;
+		char* cursor_ = nullptr;
+		char* chunkEnd_ = nullptr;
+		std::size_t currentChunk_ = 0;
+	};
+}
+
+#endif //TASKKIT_FRAME_ARENA_ALLOCATOR_H
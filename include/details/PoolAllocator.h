@@ -1,44 +1,386 @@
 #ifndef TASKKIT_POOL_ALLOCATOR_H
 #define TASKKIT_POOL_ALLOCATOR_H
 
+#include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <algorithm>
 #include <array>
+#include <memory>
 #include <new>
 #include <atomic>
 #include <thread>
 #include <unordered_map>
 #include <mutex>
 #include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "CacheLine.h"
+#include "Exceptions.h"
+#include "PoolAllocatorConfiguration.h"
 #include "TaskAllocator.h"
 
+#if __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#include <unistd.h>
+#define TASKKIT_HAS_MMAP 1
+#else
+#define TASKKIT_HAS_MMAP 0
+#endif
+
+// Keeps cold paths out of the inlined allocation fast path.
+#if defined(_MSC_VER)
+#define TASKKIT_NOINLINE __declspec(noinline)
+#else
+#define TASKKIT_NOINLINE __attribute__((noinline))
+#endif
+
 namespace TKit
 {
+	namespace Details
+	{
+		// Size classes are 16 bytes apart up to SmallPoolSizeLimit, then four per power of two up to MaxPoolSize,
+		// which bounds the internal waste to 16 bytes for small frames and 25% above that.
+		inline constexpr std::size_t PoolGranuleSize = 16;
+		inline constexpr std::size_t SmallPoolSizeLimit = 128;
+		inline constexpr std::size_t PoolSizesPerDoubling = 4;
+		inline constexpr std::size_t MaxPoolSize = 8192;
+
+		consteval std::size_t CountPoolSizes()
+		{
+			std::size_t count = SmallPoolSizeLimit / PoolGranuleSize;
+			for (std::size_t base = SmallPoolSizeLimit; base < MaxPoolSize; base *= 2)
+			{
+				count += PoolSizesPerDoubling;
+			}
+			return count;
+		}
+
+		consteval auto MakePoolSizes()
+		{
+			std::array<std::size_t, CountPoolSizes()> sizes{};
+			std::size_t index = 0;
+			for (std::size_t size = PoolGranuleSize; size <= SmallPoolSizeLimit; size += PoolGranuleSize)
+			{
+				sizes[index++] = size;
+			}
+			for (std::size_t base = SmallPoolSizeLimit; base < MaxPoolSize; base *= 2)
+			{
+				for (std::size_t step = 1; step <= PoolSizesPerDoubling; ++step)
+				{
+					sizes[index++] = base + base / PoolSizesPerDoubling * step;
+				}
+			}
+			return sizes;
+		}
+
+		inline constexpr auto PoolSizes = MakePoolSizes();
+		static_assert(PoolSizes.back() == MaxPoolSize && PoolSizes.size() < UINT8_MAX, "Slab headers store the class in one byte");
+
+		// Maps a size rounded up to whole granules straight to its class, so lookup is one load instead of a scan.
+		consteval auto MakePoolIndexTable()
+		{
+			std::array<std::uint8_t, MaxPoolSize / PoolGranuleSize + 1> table{};
+			std::size_t index = 0;
+			for (std::size_t granule = 0; granule < table.size(); ++granule)
+			{
+				while (PoolSizes[index] < granule * PoolGranuleSize)
+				{
+					++index;
+				}
+				table[granule] = static_cast<std::uint8_t>(index);
+			}
+			return table;
+		}
+
+		inline constexpr auto PoolIndexTable = MakePoolIndexTable();
+
+		// Written only by the thread that owns the pool and read by GetStats from any thread, so a relaxed load and store
+		// are enough and the hot path never pays for a locked instruction.
+		class RelaxedCounter
+		{
+		public:
+			void Add(std::size_t value) noexcept
+			{
+				value_.store(value_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+			}
+
+			void Subtract(std::size_t value) noexcept
+			{
+				value_.store(value_.load(std::memory_order_relaxed) - value, std::memory_order_relaxed);
+			}
+
+			[[nodiscard]]
+			std::size_t Get() const noexcept
+			{
+				return value_.load(std::memory_order_relaxed);
+			}
+
+		private:
+			std::atomic<std::size_t> value_{0};
+		};
+
+		// Mappings are made and released in whole pages, so mapped blocks are sized with this.
+		[[nodiscard]]
+		inline std::size_t RoundUpToPageSize(std::size_t bytes) noexcept
+		{
+#if TASKKIT_HAS_MMAP
+			static const auto pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+			return (bytes + pageSize - 1) & ~(pageSize - 1);
+#else
+			return bytes;
+#endif
+		}
+
+		// Maps bytes aligned to alignment straight from the OS, or returns nullptr where mapping is unavailable. Both
+		// must be whole pages.
+		inline void* MapMemory(std::size_t bytes, std::size_t alignment)
+		{
+#if TASKKIT_HAS_MMAP
+			assert(bytes == RoundUpToPageSize(bytes) && alignment == RoundUpToPageSize(alignment) &&
+				"PoolAllocator: mappings must span whole pages");
+			const std::size_t mappedBytes = bytes + alignment;
+			void* mapping = ::mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (mapping == MAP_FAILED)
+			{
+				throw std::bad_alloc();
+			}
+
+			// Keep only the aligned part of the over-sized mapping.
+			auto* begin = static_cast<char*>(mapping);
+			auto* aligned = reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(begin) + alignment - 1) & ~(alignment - 1));
+			auto* end = begin + mappedBytes;
+			if (aligned != begin)
+			{
+				[[maybe_unused]] const int result = ::munmap(begin, static_cast<std::size_t>(aligned - begin));
+				assert(result == 0 && "PoolAllocator: failed to unmap the head of a mapping");
+			}
+			if (aligned + bytes != end)
+			{
+				[[maybe_unused]] const int result = ::munmap(aligned + bytes, static_cast<std::size_t>(end - (aligned + bytes)));
+				assert(result == 0 && "PoolAllocator: failed to unmap the tail of a mapping");
+			}
+			return aligned;
+#else
+			static_cast<void>(bytes);
+			static_cast<void>(alignment);
+			return nullptr;
+#endif
+		}
+
+		inline void UnmapMemory([[maybe_unused]] void* ptr, [[maybe_unused]] std::size_t bytes) noexcept
+		{
+#if TASKKIT_HAS_MMAP
+			[[maybe_unused]] const int result = ::munmap(ptr, bytes);
+			assert(result == 0 && "PoolAllocator: failed to unmap a block");
+#endif
+		}
+	}
+
 	class PoolAllocator
 	{
 	public:
-		static constexpr std::array<std::size_t, 9> PoolSizes = {
-			48, 64, 128, 256, 512, 1024, 2048, 4096, 8192
+		// The default size classes; PoolAllocatorConfiguration::sizeClasses can replace them per allocator.
+		static constexpr auto PoolSizes = Details::PoolSizes;
+
+		// Upper bound on the number of classes in a custom table.
+		static constexpr std::size_t MaxSizeClassCount = 64;
+
+		// Returns the default class serving size, or -1 when it is larger than every class and goes straight to the heap.
+		[[nodiscard]]
+		static constexpr int FindPoolIndex(std::size_t size) noexcept
+		{
+			if (size > Details::MaxPoolSize)
+			{
+				return -1;
+			}
+			return Details::PoolIndexTable[(size + Details::PoolGranuleSize - 1) / Details::PoolGranuleSize];
+		}
+
+		// Slabs are aligned to their own size, so masking any block address finds the header with its owner and class.
+		static constexpr std::size_t SlabSize = 64 * 1024;
+
+		// Slabs are allocated in contiguous runs that double per class up to this many slabs, so a spawn burst costs a
+		// handful of heap calls rather than one per slab.
+		static constexpr std::size_t MaxSlabsPerRun = 16;
+
+		// Cross-thread frees are chained per owner pool and published with one CAS once this many pile up, or on
+		// FlushRemoteFrees. Each thread batches for up to RemoteFreeBatchCount owners at a time.
+		static constexpr std::size_t RemoteFreeBatchSize = 32;
+		static constexpr std::size_t RemoteFreeBatchCount = 4;
+
+		// Each thread remembers the pools of the allocators it used most recently, so alternating between a few
+		// allocators costs a short scan of thread-local memory rather than a lock.
+		static constexpr std::size_t ThreadPoolCacheSize = 4;
+
+		// Each thread draws on the memory budget in steps of up to this many bytes, a 64th of the budget for small ones,
+		// and hands back what it frees once it holds more than two steps, so budgeting costs no atomic per frame. Credit
+		// also goes back on Flush and, while producers wait for budget, on every free.
+		static constexpr std::size_t MaxBudgetStepSize = 64 * 1024;
+
+		// Freed blocks above MaxPoolSize are kept per thread in power-of-two buckets from MinLargeBlockSize up to
+		// PoolAllocatorConfiguration::largeCacheLimit, header included.
+		static constexpr std::size_t MinLargeBlockSize = 16 * 1024;
+		static constexpr std::size_t LargeBucketCount = 16;
+
+		struct SizeClassStats
+		{
+			std::size_t blockSize = 0;
+			std::size_t liveBlocks = 0;
+			// Blocks on the free list; memory not carved yet is not counted.
+			std::size_t freeBlocks = 0;
+			std::size_t slabs = 0;
+			std::size_t remoteFreesReceived = 0;
+			std::size_t allocations = 0;
+			// Bytes lost to rounding requests up to blockSize, summed over every allocation so far.
+			std::size_t wastedBytes = 0;
 		};
 
-	private:
-		struct ThreadLocalPool;
+		struct ThreadStats
+		{
+			// Empty for a pool whose thread exited and that no thread has adopted yet.
+			std::thread::id threadId;
+			// One entry per class of the allocator's table.
+			std::vector<SizeClassStats> sizeClasses;
+			std::size_t largeAllocations = 0;
+			std::size_t largeCacheHits = 0;
+			std::size_t largeCachedBytes = 0;
+		};
 
-		struct alignas(std::max_align_t) BlockMeta
+		struct Stats
 		{
-			ThreadLocalPool* ownerPool;
-			std::uint8_t poolIndex;
+			std::vector<ThreadStats> threads;
+			std::vector<SizeClassStats> sizeClasses;
+			std::size_t largeAllocations = 0;
+			std::size_t largeCacheHits = 0;
+			std::size_t largeCachedBytes = 0;
+			// Slab memory held by every pool, cached large blocks excluded.
+			std::size_t reservedBytes = 0;
+			// Bytes charged against the memory budget, including steps threads have drawn but not used yet; zero
+			// without a budget.
+			std::size_t budgetUsedBytes = 0;
+		};
+
+		// Linked into the allocator by WaitForBudget. wake is called once, on whichever thread brings usage back within
+		// budget, and the waiter is unlinked before that.
+		struct BudgetWaiter
+		{
+			void (*wake)(BudgetWaiter* waiter) = nullptr;
+			BudgetWaiter* next = nullptr;
+		};
+
+		struct SizeHistogramEntry
+		{
+			// Requested size rounded up to the 16-byte step, which is also the smallest class that would serve it exactly.
+			std::size_t size = 0;
+			std::size_t count = 0;
+		};
+
+		struct SizeHistogram
+		{
+			// Ascending, sizes never requested left out.
+			std::vector<SizeHistogramEntry> sizes;
+			// Requests larger than every size a class may have.
+			std::size_t largeCount = 0;
 		};
 
-		static constexpr std::size_t MetaSize = sizeof(BlockMeta);
-		static constexpr std::size_t AlignedMetaSize =
-			(MetaSize + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+		// Picks up to classCount classes minimizing the bytes lost to rounding the recorded requests up, for
+		// PoolAllocatorConfiguration::Builder::WithSizeClasses. When the histogram does not reach the largest size a class
+		// may have, that size is kept as the last class so rarer frames stay pooled.
+		[[nodiscard]]
+		static std::vector<std::size_t> FitSizeClasses(const SizeHistogram& histogram, std::size_t classCount = PoolSizes.size())
+		{
+			assert(classCount > 0 && classCount <= MaxSizeClassCount && "PoolAllocator: invalid size class count");
+
+			const auto& sizes = histogram.sizes;
+			const bool needsCatchAll = sizes.empty() || sizes.back().size < Details::MaxPoolSize;
+			const std::size_t fittedCount = std::min(classCount - (needsCatchAll ? 1 : 0), sizes.size());
+
+			std::vector<std::size_t> classes;
+			if (fittedCount > 0)
+			{
+				// Serving sizes[first..last] with class sizes[last] wastes sizes[last].size * count - bytes over the range.
+				const std::size_t n = sizes.size();
+				std::vector<std::size_t> prefixCount(n + 1, 0);
+				std::vector<std::size_t> prefixBytes(n + 1, 0);
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					prefixCount[i + 1] = prefixCount[i] + sizes[i].count;
+					prefixBytes[i + 1] = prefixBytes[i] + sizes[i].count * sizes[i].size;
+				}
+				const auto getWaste = [&](std::size_t first, std::size_t last)
+				{
+					return sizes[last].size * (prefixCount[last + 1] - prefixCount[first]) - (prefixBytes[last + 1] - prefixBytes[first]);
+				};
+
+				// waste[k][i] is the least waste serving sizes[0..i] with k + 1 classes, the largest one being sizes[i].
+				std::vector<std::vector<std::size_t>> waste(fittedCount, std::vector<std::size_t>(n, SIZE_MAX));
+				std::vector<std::vector<std::size_t>> previous(fittedCount, std::vector<std::size_t>(n, 0));
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					waste[0][i] = getWaste(0, i);
+				}
+				for (std::size_t k = 1; k < fittedCount; ++k)
+				{
+					for (std::size_t i = k; i < n; ++i)
+					{
+						for (std::size_t j = k - 1; j < i; ++j)
+						{
+							const std::size_t candidate = waste[k - 1][j] + getWaste(j + 1, i);
+							if (candidate < waste[k][i])
+							{
+								waste[k][i] = candidate;
+								previous[k][i] = j;
+							}
+						}
+					}
+				}
+
+				classes.resize(fittedCount);
+				std::size_t last = n - 1;
+				for (std::size_t k = fittedCount; k-- > 0;)
+				{
+					classes[k] = sizes[last].size;
+					last = previous[k][last];
+				}
+			}
+
+			if (needsCatchAll)
+			{
+				classes.push_back(Details::MaxPoolSize);
+			}
+			return classes;
+		}
+
+	private:
+		struct ThreadLocalPool;
 
+		// Live counts are only touched by the owner thread: remote frees are counted when the owner collects them.
 		struct alignas(std::max_align_t) Slab
 		{
+			ThreadLocalPool* ownerPool;
 			Slab* next;
-			std::size_t size;
+			std::uint32_t liveCount;
+			std::uint16_t runIndex;
+			std::uint16_t runSlabCount;
+			std::uint8_t poolIndex;
+			bool isReleasable;
+			bool isMapped;
+			// Size of a large block including this header; zero for slabs.
+			std::size_t largeBytes;
 		};
 
+		static_assert(sizeof(Slab) + Details::MaxPoolSize <= SlabSize, "Every class must fit in one slab");
+		static_assert(sizeof(Slab) + Details::MaxPoolSize <= MinLargeBlockSize, "Every large block must fit in a bucket");
+
+		static constexpr std::size_t LargePoolIndex = MaxSizeClassCount;
+		static_assert(LargePoolIndex < UINT8_MAX && MaxSizeClassCount < INT8_MAX, "Classes are stored in one byte");
+
+		// One step per PoolGranuleSize up to MaxPoolSize, then one for everything larger.
+		static constexpr std::size_t SizeHistogramLength = Details::MaxPoolSize / Details::PoolGranuleSize + 2;
+
 		struct FreeNode
 		{
 			FreeNode* next;
@@ -47,45 +389,98 @@ namespace TKit
 		struct RemoteFreeNode
 		{
 			RemoteFreeNode* next;
-			std::size_t poolIndex;
+		};
+
+		struct RemoteFreeBatch
+		{
+			ThreadLocalPool* target = nullptr;
+			RemoteFreeNode* head = nullptr;
+			RemoteFreeNode* tail = nullptr;
+			std::size_t count = 0;
+		};
+
+		struct SizeClassCounters
+		{
+			Details::RelaxedCounter liveBlocks;
+			Details::RelaxedCounter freeBlocks;
+			Details::RelaxedCounter slabs;
+			Details::RelaxedCounter remoteFreesReceived;
+			Details::RelaxedCounter allocations;
+			Details::RelaxedCounter wastedBytes;
 		};
 
 		struct PoolState
 		{
 			FreeNode* freeList = nullptr;
-			Slab* slabs = nullptr;
+			char* bumpCursor = nullptr;
+			char* slabEnd = nullptr;
+			char* runEnd = nullptr;
+			std::size_t nextRunSlabCount = 1;
+			std::size_t blockSize = 0;
 		};
 
 		struct ThreadLocalPool
 		{
 			PoolAllocator* parent;
 			std::uint64_t allocatorId;
-			std::thread::id ownerId;
-			std::array<PoolState, PoolSizes.size()> pools;
-			std::atomic<RemoteFreeNode*> remoteFreeHead{nullptr};
+			// Cleared when the owner thread exits and set again by the thread that adopts the pool.
+			std::atomic<std::thread::id> ownerId;
+			// Other threads push here, and read the fields above on every free; the owner-only state starts on the next line.
+			alignas(Details::CacheLineSize) std::atomic<RemoteFreeNode*> remoteFreeHead{nullptr};
+			alignas(Details::CacheLineSize) std::array<PoolState, MaxSizeClassCount> pools;
+			Slab* slabs = nullptr;
+			std::size_t reservedBytes = 0;
+			std::size_t liveBytes = 0;
+			std::size_t trimLiveBytesThreshold = SIZE_MAX;
+			// Budget this thread has drawn and not yet spent on frames.
+			std::size_t budgetCredit = 0;
+			// Blocks this thread freed for other pools; they stay live in their owner until the batch is published.
+			std::array<RemoteFreeBatch, RemoteFreeBatchCount> remoteFreeBatches;
+			std::size_t nextEvictedBatch = 0;
+			// Large blocks this thread freed, linked through their headers; any thread's large blocks may end up here.
+			std::array<Slab*, LargeBucketCount> largeCache{};
+			std::array<std::size_t, LargeBucketCount> largeCacheCounts{};
+			std::array<SizeClassCounters, MaxSizeClassCount> counters;
+			Details::RelaxedCounter largeAllocations;
+			Details::RelaxedCounter largeCacheHits;
+			Details::RelaxedCounter largeCachedBytes;
+			// Only allocated when the allocator records a size histogram.
+			std::unique_ptr<Details::RelaxedCounter[]> sizeHistogram;
 
 			ThreadLocalPool(PoolAllocator* p, std::uint64_t id, std::thread::id tid)
 				: parent(p), allocatorId(id), ownerId(tid)
 			{
+				for (std::size_t i = 0; i < parent->poolSizes_.size(); ++i)
+				{
+					pools[i].blockSize = parent->poolSizes_[i];
+				}
+				if (parent->configuration_.recordSizeHistogram)
+				{
+					sizeHistogram = std::make_unique<Details::RelaxedCounter[]>(SizeHistogramLength);
+				}
 			}
 
+			// Only the first slab of each run is linked, and freeing it releases the whole run.
 			~ThreadLocalPool()
 			{
-				for (std::size_t i = 0; i < pools.size(); ++i)
+				ReleaseLargeCache();
+
+				Slab* slab = slabs;
+				while (slab)
 				{
-					auto& pool = pools[i];
-					Slab* slab = pool.slabs;
-					while (slab)
-					{
-						Slab* next = slab->next;
-						::operator delete(slab);
-						slab = next;
-					}
+					Slab* next = slab->next;
+					::operator delete(slab, std::align_val_t{SlabSize});
+					slab = next;
 				}
 			}
 
 			void CollectRemoteFree()
 			{
+				if (remoteFreeHead.load(std::memory_order_relaxed) == nullptr)
+				{
+					return;
+				}
+
 				RemoteFreeNode* head = remoteFreeHead.exchange(nullptr, std::memory_order_acquire);
 
 				while (head != nullptr)
@@ -93,92 +488,512 @@ namespace TKit
 					RemoteFreeNode* current = head;
 					head = current->next;
 
-					const std::size_t poolIndex = current->poolIndex;
+					Slab* slab = GetSlab(current);
+					--slab->liveCount;
+					liveBytes -= pools[slab->poolIndex].blockSize;
+					counters[slab->poolIndex].liveBlocks.Subtract(1);
+					counters[slab->poolIndex].remoteFreesReceived.Add(1);
+					PushFree(current, slab->poolIndex);
+				}
+			}
+
+			void PushRemoteFree(RemoteFreeNode* head, RemoteFreeNode* tail)
+			{
+				RemoteFreeNode* oldHead = remoteFreeHead.load(std::memory_order_relaxed);
+				do
+				{
+					tail->next = oldHead;
+				} while (!remoteFreeHead.compare_exchange_weak(
+					oldHead, head,
+					std::memory_order_release,
+					std::memory_order_relaxed));
+			}
+
+			// Called on the freeing thread's own pool; when every batch is taken, the next one in turn is published early.
+			void BatchRemoteFree(ThreadLocalPool* target, void* ptr)
+			{
+				RemoteFreeBatch* batch = nullptr;
+				for (auto& candidate : remoteFreeBatches)
+				{
+					if (candidate.target == target)
+					{
+						batch = &candidate;
+						break;
+					}
+					if (!batch && !candidate.target)
+					{
+						batch = &candidate;
+					}
+				}
+				if (!batch)
+				{
+					batch = &remoteFreeBatches[nextEvictedBatch];
+					nextEvictedBatch = (nextEvictedBatch + 1) % RemoteFreeBatchCount;
+					PublishBatch(*batch);
+				}
+
+				auto* node = new (ptr) RemoteFreeNode{batch->head};
+				if (!batch->head)
+				{
+					batch->tail = node;
+				}
+				batch->head = node;
+				batch->target = target;
+
+				if (++batch->count == RemoteFreeBatchSize)
+				{
+					PublishBatch(*batch);
+				}
+			}
+
+			void FlushRemoteFrees()
+			{
+				for (auto& batch : remoteFreeBatches)
+				{
+					if (batch.target)
+					{
+						PublishBatch(batch);
+					}
+				}
+			}
+
+			void FreeLocal(Slab* slab, void* ptr)
+			{
+				--slab->liveCount;
+				liveBytes -= pools[slab->poolIndex].blockSize;
+				counters[slab->poolIndex].liveBlocks.Subtract(1);
+				PushFree(ptr, slab->poolIndex);
+
+				// Halving the threshold after each trim keeps a fragmented pool from trimming on every free.
+				if (reservedBytes > parent->configuration_.highWaterMark &&
+				    liveBytes < reservedBytes / 2 &&
+				    liveBytes < trimLiveBytesThreshold)
+				{
+					Trim();
+					trimLiveBytesThreshold = liveBytes / 2;
+				}
+			}
+
+			// Reuses freed blocks before carving new ones, so a run is only touched once its class runs dry.
+			void* AllocateFromPool(std::size_t poolIndex, std::size_t size)
+			{
+				void* block = PopFree(poolIndex);
+				if (!block)
+				{
+					block = Carve(poolIndex);
+				}
+				if (!block)
+				{
+					auto& pool = pools[poolIndex];
+					AllocateRun(poolIndex, pool.nextRunSlabCount);
+					pool.nextRunSlabCount = std::min(pool.nextRunSlabCount * 2, MaxSlabsPerRun);
+					block = Carve(poolIndex);
+				}
+
+				const std::size_t blockSize = pools[poolIndex].blockSize;
+				++GetSlab(block)->liveCount;
+				liveBytes += blockSize;
+
+				auto& classCounters = counters[poolIndex];
+				classCounters.liveBlocks.Add(1);
+				classCounters.allocations.Add(1);
+				classCounters.wastedBytes.Add(blockSize - size);
+				return block;
+			}
+
+			// Returns runs with no live block to the heap, after dropping their blocks from the free lists.
+			std::size_t Trim()
+			{
+				CollectRemoteFree();
+				const std::size_t releasedLargeBytes = ReleaseLargeCache();
+
+				bool anyReleasable = false;
+				for (Slab* run = slabs; run; run = run->next)
+				{
+					run->isReleasable = IsRunFree(run);
+					anyReleasable |= run->isReleasable;
+				}
+				if (!anyReleasable)
+				{
+					return releasedLargeBytes;
+				}
+
+				for (std::size_t poolIndex = 0; poolIndex < parent->poolSizes_.size(); ++poolIndex)
+				{
+					auto& pool = pools[poolIndex];
+					FreeNode** link = &pool.freeList;
+					while (*link)
+					{
+						if (GetRun(GetSlab(*link))->isReleasable)
+						{
+							*link = (*link)->next;
+							counters[poolIndex].freeBlocks.Subtract(1);
+						}
+						else
+						{
+							link = &(*link)->next;
+						}
+					}
+
+					if (pool.runEnd && GetRun(GetSlab(pool.slabEnd - 1))->isReleasable)
+					{
+						pool.bumpCursor = nullptr;
+						pool.slabEnd = nullptr;
+						pool.runEnd = nullptr;
+					}
+				}
 
-					if (poolIndex < PoolSizes.size())
+				std::size_t releasedBytes = 0;
+				Slab** link = &slabs;
+				while (*link)
+				{
+					Slab* run = *link;
+					if (run->isReleasable)
 					{
-						auto* freeNode = new (current) FreeNode{};
-						freeNode->next = pools[poolIndex].freeList;
-						pools[poolIndex].freeList = freeNode;
+						*link = run->next;
+						releasedBytes += run->runSlabCount * SlabSize;
+						counters[run->poolIndex].slabs.Subtract(run->runSlabCount);
+						// Growth starts over, or the next allocation would reserve a spike-sized run again.
+						pools[run->poolIndex].nextRunSlabCount = 1;
+						::operator delete(run, std::align_val_t{SlabSize});
 					}
 					else
 					{
-						::operator delete(current);
+						link = &run->next;
+					}
+				}
+
+				reservedBytes -= releasedBytes;
+				return releasedBytes + releasedLargeBytes;
+			}
+
+			// Makes sure at least count blocks can be carved without going to the heap.
+			void Reserve(std::size_t poolIndex, std::size_t count)
+			{
+				const std::size_t capacity = GetCarveCapacity(poolIndex);
+				if (capacity >= count)
+				{
+					return;
+				}
+
+				// The rest of the current run moves to the free list so the new run can start right away.
+				while (void* block = Carve(poolIndex))
+				{
+					PushFree(block, poolIndex);
+				}
+
+				const std::size_t blocksPerSlab = GetBlocksPerSlab(poolIndex);
+				AllocateRun(poolIndex, (count - capacity + blocksPerSlab - 1) / blocksPerSlab);
+			}
+
+			// Larger than every class: gets a slab of its own. Up to the cache limit the size is rounded to a bucket and a
+			// block this thread freed earlier is reused; above the mapping threshold it comes straight from the OS.
+			void* AllocateLarge(std::size_t size)
+			{
+				const auto& configuration = parent->configuration_;
+				std::size_t bytes = sizeof(Slab) + size;
+
+				const std::size_t bucket = GetLargeBucket(bytes);
+				const bool isCacheable = bucket < LargeBucketCount && GetLargeBucketSize(bucket) <= configuration.largeCacheLimit;
+				const bool isMappable = !isCacheable && bytes >= configuration.mappedAllocationThreshold;
+				if (isCacheable)
+				{
+					bytes = GetLargeBucketSize(bucket);
+				}
+				else if (isMappable)
+				{
+					// Sized in whole pages so that FreeLarge unmaps all of it.
+					bytes = Details::RoundUpToPageSize(bytes);
+				}
+				if (parent->hasBudget_)
+				{
+					parent->ChargeBudget(*this, bytes);
+				}
+
+				largeAllocations.Add(1);
+				if (isCacheable)
+				{
+					if (Slab* cached = largeCache[bucket])
+					{
+						largeCache[bucket] = cached->next;
+						--largeCacheCounts[bucket];
+						largeCacheHits.Add(1);
+						largeCachedBytes.Subtract(bytes);
+						cached->next = nullptr;
+						return reinterpret_cast<char*>(cached) + sizeof(Slab);
+					}
+				}
+
+				void* memory = nullptr;
+				bool isMapped = false;
+				try
+				{
+					if (isMappable)
+					{
+						memory = Details::MapMemory(bytes, SlabSize);
+						isMapped = memory != nullptr;
+					}
+					if (!memory)
+					{
+						memory = ::operator new(bytes, std::align_val_t{SlabSize});
+					}
+				}
+				catch (...)
+				{
+					largeAllocations.Subtract(1);
+					if (parent->hasBudget_)
+					{
+						parent->ReleaseBudget(*this, bytes);
+					}
+					throw;
+				}
+
+				Slab* slab = InitializeSlab(memory, LargePoolIndex);
+				slab->isMapped = isMapped;
+				slab->largeBytes = bytes;
+				return static_cast<char*>(memory) + sizeof(Slab);
+			}
+
+			// Runs on whichever thread frees the block, so the cache it lands in is that thread's.
+			void FreeLarge(Slab* slab)
+			{
+				if (parent->hasBudget_)
+				{
+					parent->ReleaseBudget(*this, slab->largeBytes);
+				}
+
+				if (slab->isMapped)
+				{
+					Details::UnmapMemory(slab, slab->largeBytes);
+					return;
+				}
+
+				const std::size_t bucket = GetLargeBucket(slab->largeBytes);
+				if (bucket < LargeBucketCount &&
+				    GetLargeBucketSize(bucket) == slab->largeBytes &&
+				    largeCacheCounts[bucket] < parent->configuration_.largeCacheDepth)
+				{
+					slab->next = largeCache[bucket];
+					largeCache[bucket] = slab;
+					++largeCacheCounts[bucket];
+					largeCachedBytes.Add(slab->largeBytes);
+					return;
+				}
+
+				::operator delete(slab, std::align_val_t{SlabSize});
+			}
+
+		private:
+			[[nodiscard]]
+			static constexpr std::size_t GetLargeBucketSize(std::size_t bucket) noexcept
+			{
+				return MinLargeBlockSize << bucket;
+			}
+
+			// Index of the smallest bucket holding bytes; LargeBucketCount when none does.
+			[[nodiscard]]
+			static constexpr std::size_t GetLargeBucket(std::size_t bytes) noexcept
+			{
+				std::size_t bucket = 0;
+				while (bucket < LargeBucketCount && GetLargeBucketSize(bucket) < bytes)
+				{
+					++bucket;
+				}
+				return bucket;
+			}
+
+			std::size_t ReleaseLargeCache() noexcept
+			{
+				std::size_t releasedBytes = 0;
+				for (std::size_t bucket = 0; bucket < LargeBucketCount; ++bucket)
+				{
+					while (Slab* slab = largeCache[bucket])
+					{
+						largeCache[bucket] = slab->next;
+						releasedBytes += slab->largeBytes;
+						::operator delete(slab, std::align_val_t{SlabSize});
+					}
+					largeCacheCounts[bucket] = 0;
+				}
+				largeCachedBytes.Subtract(releasedBytes);
+				return releasedBytes;
+			}
+
+			static void PublishBatch(RemoteFreeBatch& batch)
+			{
+				batch.target->PushRemoteFree(batch.head, batch.tail);
+				batch = RemoteFreeBatch{};
+			}
+
+			void PushFree(void* ptr, std::size_t poolIndex) noexcept
+			{
+				auto* node = new (ptr) FreeNode{};
+				node->next = pools[poolIndex].freeList;
+				pools[poolIndex].freeList = node;
+				counters[poolIndex].freeBlocks.Add(1);
+			}
+
+			void* PopFree(std::size_t poolIndex)
+			{
+				auto& pool = pools[poolIndex];
+				if (!pool.freeList)
+				{
+					CollectRemoteFree();
+				}
+
+				FreeNode* node = pool.freeList;
+				if (node)
+				{
+					pool.freeList = node->next;
+					counters[poolIndex].freeBlocks.Subtract(1);
+				}
+				return node;
+			}
+
+			[[nodiscard]]
+			static Slab* GetRun(Slab* slab) noexcept
+			{
+				return std::launder(reinterpret_cast<Slab*>(reinterpret_cast<char*>(slab) - slab->runIndex * SlabSize));
+			}
+
+			[[nodiscard]]
+			static bool IsRunFree(Slab* run) noexcept
+			{
+				auto* slab = reinterpret_cast<char*>(run);
+				for (std::size_t i = 0; i < run->runSlabCount; ++i)
+				{
+					if (std::launder(reinterpret_cast<Slab*>(slab + i * SlabSize))->liveCount != 0)
+					{
+						return false;
 					}
 				}
+				return true;
 			}
 
-			void PushRemoteFree(void* ptr, std::size_t poolIndex)
+			[[nodiscard]]
+			std::size_t GetBlocksPerSlab(std::size_t poolIndex) const noexcept
 			{
-				auto* node = new (ptr) RemoteFreeNode{};
-				node->poolIndex = poolIndex;
+				return (SlabSize - sizeof(Slab)) / pools[poolIndex].blockSize;
+			}
 
-				RemoteFreeNode* oldHead = remoteFreeHead.load(std::memory_order_relaxed);
-				do
-				{
-					node->next = oldHead;
-				} while (!remoteFreeHead.compare_exchange_weak(
-					oldHead, node,
-					std::memory_order_release,
-					std::memory_order_relaxed));
+			[[nodiscard]]
+			std::size_t GetCarveCapacity(std::size_t poolIndex) const noexcept
+			{
+				const auto& pool = pools[poolIndex];
+				const std::size_t inSlab = static_cast<std::size_t>(pool.slabEnd - pool.bumpCursor) / pool.blockSize;
+				const std::size_t slabsLeft = static_cast<std::size_t>(pool.runEnd - pool.slabEnd) / SlabSize;
+				return inSlab + slabsLeft * GetBlocksPerSlab(poolIndex);
 			}
 
-			void* AllocateFromPool(std::size_t poolIndex)
+			// Blocks never straddle a slab boundary, so every block masks to its own slab header.
+			void* Carve(std::size_t poolIndex) noexcept
 			{
 				auto& pool = pools[poolIndex];
+				const std::size_t blockSize = pool.blockSize;
 
-				if (pool.freeList)
+				if (static_cast<std::size_t>(pool.slabEnd - pool.bumpCursor) < blockSize)
 				{
-					FreeNode* node = pool.freeList;
-					pool.freeList = node->next;
-					return node;
+					if (pool.slabEnd == pool.runEnd)
+					{
+						return nullptr;
+					}
+					pool.bumpCursor = pool.slabEnd + sizeof(Slab);
+					pool.slabEnd += SlabSize;
 				}
 
-				CollectRemoteFree();
-				if (pool.freeList)
+				void* block = pool.bumpCursor;
+				pool.bumpCursor += blockSize;
+				return block;
+			}
+
+			void AllocateRun(std::size_t poolIndex, std::size_t slabCount)
+			{
+				assert(slabCount <= UINT16_MAX && "PoolAllocator: slab run is too large");
+				auto* run = static_cast<char*>(::operator new(slabCount * SlabSize, std::align_val_t{SlabSize}));
+				for (std::size_t i = 0; i < slabCount; ++i)
 				{
-					FreeNode* node = pool.freeList;
-					pool.freeList = node->next;
-					return node;
+					InitializeSlab(run + i * SlabSize, poolIndex)->runIndex = static_cast<std::uint16_t>(i);
 				}
 
-				return AllocateNewSlab(poolIndex);
+				Slab* first = GetSlab(run);
+				first->runSlabCount = static_cast<std::uint16_t>(slabCount);
+				first->next = slabs;
+				slabs = first;
+
+				reservedBytes += slabCount * SlabSize;
+				counters[poolIndex].slabs.Add(slabCount);
+				trimLiveBytesThreshold = SIZE_MAX;
+
+				auto& pool = pools[poolIndex];
+				pool.bumpCursor = run + sizeof(Slab);
+				pool.slabEnd = run + SlabSize;
+				pool.runEnd = run + slabCount * SlabSize;
 			}
 
-			void* AllocateNewSlab(std::size_t poolIndex)
+			Slab* InitializeSlab(void* memory, std::size_t poolIndex)
 			{
-				constexpr std::size_t SlabBlockCount = 32;
-				const std::size_t userSize = PoolSizes[poolIndex];
-				const std::size_t blockSize = userSize + AlignedMetaSize;
-				const std::size_t slabDataSize = blockSize * SlabBlockCount;
-				const std::size_t slabTotalSize = sizeof(Slab) + slabDataSize;
+				auto* slab = new (memory) Slab{};
+				slab->ownerPool = this;
+				slab->poolIndex = static_cast<std::uint8_t>(poolIndex);
+				return slab;
+			}
+		};
+
+		[[nodiscard]]
+		static Slab* GetSlab(void* ptr) noexcept
+		{
+			return std::launder(reinterpret_cast<Slab*>(reinterpret_cast<std::uintptr_t>(ptr) & ~(SlabSize - 1)));
+		}
+
+		// Allocator ids start at one, so a zeroed entry never matches.
+		struct TlsCacheEntry
+		{
+			ThreadLocalPool* pool = nullptr;
+			std::uint64_t allocatorId = 0;
+		};
 
-				void* slabMemory = ::operator new(slabTotalSize);
-				auto* slab = new (slabMemory) Slab{};
-				slab->size = slabTotalSize;
-				slab->next = pools[poolIndex].slabs;
-				pools[poolIndex].slabs = slab;
+		// Hands every pool the thread created back to its allocator when the thread exits, unless the allocator is gone.
+		// Pools only change hands on thread exit, so pools is also the authoritative lookup for this thread and needs no
+		// lock; cache holds its most recently used entries first.
+		struct ThreadExitHook
+		{
+			std::array<TlsCacheEntry, ThreadPoolCacheSize> cache{};
+			std::vector<TlsCacheEntry> pools;
 
-				char* blockStart = reinterpret_cast<char*>(slab) + sizeof(Slab);
-				void* result = blockStart;
+			~ThreadExitHook()
+			{
+				cache = {};
 
-				for (std::size_t i = 1; i < SlabBlockCount; ++i)
+				std::lock_guard lock(GetRegistryMutex());
+				for (const auto& [pool, allocatorId] : pools)
 				{
-					void* blockAddr = blockStart + i * blockSize;
-					auto* node = new (blockAddr) FreeNode{};
-					node->next = pools[poolIndex].freeList;
-					pools[poolIndex].freeList = node;
+					const auto itr = GetRegistry().find(allocatorId);
+					if (itr != GetRegistry().end())
+					{
+						itr->second->Orphan(pool);
+					}
 				}
-
-				return result;
 			}
 		};
 
-		struct TlsCacheEntry
+		// Live allocators by id, so a thread outliving an allocator does not touch it on exit.
+		static std::unordered_map<std::uint64_t, PoolAllocator*>& GetRegistry()
 		{
-			ThreadLocalPool* pool;
-			std::uint64_t allocatorId;
-		};
+			static std::unordered_map<std::uint64_t, PoolAllocator*> registry;
+			return registry;
+		}
+
+		static std::mutex& GetRegistryMutex()
+		{
+			static std::mutex mutex;
+			return mutex;
+		}
+
+		static ThreadExitHook& GetThreadExitHook()
+		{
+			thread_local ThreadExitHook hook;
+			return hook;
+		}
 
 		static std::uint64_t GetNextId()
 		{
@@ -187,51 +1002,120 @@ namespace TKit
 		}
 
 	public:
-		PoolAllocator()
-			: id_(GetNextId())
+		explicit PoolAllocator(const PoolAllocatorConfiguration& configuration = PoolAllocatorConfiguration{})
+			: id_(GetNextId()),
+			  configuration_(configuration)
 		{
+			if (configuration_.sizeClasses.empty())
+			{
+				poolSizes_.assign(PoolSizes.begin(), PoolSizes.end());
+			}
+			else
+			{
+				poolSizes_ = configuration_.sizeClasses;
+			}
+			BuildPoolIndexTable();
+
+			hasBudget_ = configuration_.memoryBudget != SIZE_MAX;
+			budgetStepSize_ = std::min(MaxBudgetStepSize, configuration_.memoryBudget / 64);
+			assert((configuration_.memoryBudgetPolicy != MemoryBudgetPolicy::Hook || configuration_.memoryBudgetHook) &&
+				"PoolAllocator: MemoryBudgetPolicy::Hook needs a hook");
+
+			std::lock_guard lock(GetRegistryMutex());
+			GetRegistry().emplace(id_, this);
 		}
 
 		~PoolAllocator()
 		{
+			{
+				std::lock_guard lock(GetRegistryMutex());
+				GetRegistry().erase(id_);
+			}
+
 			std::lock_guard lock(poolsMutex_);
 			for (const auto& pool: threadPools_ | std::views::values)
 			{
 				delete pool;
 			}
+			for (ThreadLocalPool* pool : orphanedPools_)
+			{
+				delete pool;
+			}
 		}
 
 		void* Allocate(std::size_t size)
 		{
 			ThreadLocalPool* pool = GetOrCreateThreadPool();
 
-			const int poolIndex = FindPoolIndex(size);
+			if (pool->sizeHistogram)
+			{
+				const std::size_t step = (size + Details::PoolGranuleSize - 1) / Details::PoolGranuleSize;
+				pool->sizeHistogram[std::min(step, SizeHistogramLength - 1)].Add(1);
+			}
 
+			const int poolIndex = GetPoolIndex(size);
 			if (poolIndex >= 0)
 			{
-				void* rawPtr = pool->AllocateFromPool(static_cast<std::size_t>(poolIndex));
-
-				auto* meta = new (rawPtr) BlockMeta{};
-				meta->ownerPool = pool;
-				meta->poolIndex = static_cast<std::uint8_t>(poolIndex);
+				const auto index = static_cast<std::size_t>(poolIndex);
+				if (hasBudget_)
+				{
+					ChargeBudget(*pool, poolSizes_[index]);
+					try
+					{
+						return pool->AllocateFromPool(index, size);
+					}
+					catch (...)
+					{
+						// A slab that could not be created holds no frame, so the charge goes back.
+						ReleaseBudget(*pool, poolSizes_[index]);
+						throw;
+					}
+				}
+				return pool->AllocateFromPool(index, size);
+			}
 
-				void* userPtr = static_cast<char*>(rawPtr) + AlignedMetaSize;
+			return pool->AllocateLarge(size);
+		}
 
-				return userPtr;
+		// Lets the calling thread allocate at least count blocks of size without a heap allocation, e.g. while loading.
+		// Sizes larger than every class are ignored.
+		void Reserve(std::size_t size, std::size_t count)
+		{
+			const int poolIndex = GetPoolIndex(size);
+			if (poolIndex < 0 || count == 0)
+			{
+				return;
 			}
 
-			const std::size_t allocSize = size + AlignedMetaSize;
-			void* rawPtr = ::operator new(allocSize);
-
-			auto* meta = new (rawPtr) BlockMeta{};
-			meta->ownerPool = pool;
-			meta->poolIndex = static_cast<std::uint8_t>(PoolSizes.size());
+			GetOrCreateThreadPool()->Reserve(static_cast<std::size_t>(poolIndex), count);
+		}
 
-			void* userPtr = static_cast<char*>(rawPtr) + AlignedMetaSize;
+		// Returns the calling thread's fully free slab runs to the heap, including blocks other threads have freed back to
+		// it, and reports the number of bytes released. Other threads' pools are trimmed from those threads.
+		// Pools left behind by exited threads are trimmed too, and dropped once they hold no memory.
+		std::size_t Trim()
+		{
+			ThreadLocalPool* pool = GetOrCreateThreadPool();
+			pool->FlushRemoteFrees();
+			std::size_t releasedBytes = pool->Trim();
 
-			return userPtr;
+			std::lock_guard lock(poolsMutex_);
+			std::erase_if(orphanedPools_, [this, &releasedBytes](ThreadLocalPool* pool)
+			{
+				releasedBytes += pool->Trim();
+				if (pool->reservedBytes != 0)
+				{
+					return false;
+				}
+				AddThreadStats(droppedPoolStats_, GetThreadStats(*pool));
+				AddSizeHistogram(droppedSizeHistogram_, *pool);
+				delete pool;
+				return true;
+			});
+			return releasedBytes;
 		}
 
+		// The block's slab header identifies its owner and class, so size is not needed.
 		void Deallocate(void* ptr, [[maybe_unused]] std::size_t size)
 		{
 			if (!ptr)
@@ -239,35 +1123,171 @@ namespace TKit
 				return;
 			}
 
-			void* rawPtr = static_cast<char*>(ptr) - AlignedMetaSize;
-			auto* meta = std::launder(static_cast<BlockMeta*>(rawPtr));
-
-			ThreadLocalPool* ownerPool = meta->ownerPool;
-			const std::size_t poolIndex = meta->poolIndex;
+			Slab* slab = GetSlab(ptr);
+			const std::size_t poolIndex = slab->poolIndex;
 
-			if (ownerPool == nullptr)
+			if (poolIndex == LargePoolIndex)
 			{
+				GetOrCreateThreadPool()->FreeLarge(slab);
 				return;
 			}
 
-			if (poolIndex >= PoolSizes.size())
+			ThreadLocalPool* ownerPool = slab->ownerPool;
+			if (ownerPool->ownerId.load(std::memory_order_relaxed) == std::this_thread::get_id())
 			{
-				::operator delete(rawPtr);
-				return;
+				if (hasBudget_)
+				{
+					ReleaseBudget(*ownerPool, poolSizes_[poolIndex]);
+				}
+				ownerPool->FreeLocal(slab, ptr);
+			}
+			else
+			{
+				ThreadLocalPool* pool = GetOrCreateThreadPool();
+				if (hasBudget_)
+				{
+					ReleaseBudget(*pool, poolSizes_[poolIndex]);
+				}
+				pool->BatchRemoteFree(ownerPool, ptr);
+			}
+		}
+
+		// Publishes the calling thread's batched cross-thread frees to their owners.
+		void FlushRemoteFrees()
+		{
+			GetOrCreateThreadPool()->FlushRemoteFrees();
+		}
+
+		// For points where the calling thread goes idle, such as the end of a scheduler update: publishes its batched
+		// cross-thread frees and hands its unused budget credit back, so that neither waits for its next allocation.
+		void Flush()
+		{
+			ThreadLocalPool* pool = GetOrCreateThreadPool();
+			pool->FlushRemoteFrees();
+			if (hasBudget_)
+			{
+				ReturnBudgetCredit(*pool);
 			}
+		}
 
-			const std::thread::id currentThread = std::this_thread::get_id();
+		// Counters are read without stopping their threads, so a snapshot taken while they run is only approximately
+		// consistent. Remote frees still queued or batched count as live until their owner collects them. Totals keep the
+		// counts of pools that Trim has dropped.
+		[[nodiscard]]
+		Stats GetStats()
+		{
+			Stats stats;
+			std::lock_guard lock(poolsMutex_);
+			stats.threads.reserve(threadPools_.size() + orphanedPools_.size());
 
-			if (ownerPool->ownerId == currentThread)
+			for (const ThreadLocalPool* pool : threadPools_ | std::views::values)
 			{
-				auto* node = new (rawPtr) FreeNode{};
-				node->next = ownerPool->pools[poolIndex].freeList;
-				ownerPool->pools[poolIndex].freeList = node;
+				AddThreadStats(stats, stats.threads.emplace_back(GetThreadStats(*pool)));
 			}
-			else
+			for (const ThreadLocalPool* pool : orphanedPools_)
+			{
+				AddThreadStats(stats, stats.threads.emplace_back(GetThreadStats(*pool)));
+			}
+			AddThreadStats(stats, droppedPoolStats_);
+			stats.budgetUsedBytes = hasBudget_ ? budgetUsedBytes_.load(std::memory_order_relaxed) : 0;
+			return stats;
+		}
+
+		[[nodiscard]]
+		bool IsOverBudget() const noexcept
+		{
+			return budgetUsedBytes_.load() > configuration_.memoryBudget;
+		}
+
+		// Links waiter to be woken once usage is back within budget, or returns false without linking it when it
+		// already is.
+		bool WaitForBudget(BudgetWaiter& waiter)
+		{
+			// The caller's own credit is not in use while it waits.
+			ReturnBudgetCredit(*GetOrCreateThreadPool());
+
+			std::lock_guard lock(budgetWaitersMutex_);
+			waiter.next = budgetWaiters_;
+			budgetWaiters_ = &waiter;
+
+			// Pairs with ReturnBudget: either this sees the usage it left behind or it sees the waiter.
+			hasBudgetWaiters_.store(true);
+			if (IsOverBudget())
+			{
+				return true;
+			}
+
+			budgetWaiters_ = waiter.next;
+			hasBudgetWaiters_.store(budgetWaiters_ != nullptr);
+			return false;
+		}
+
+		// Unlinks a waiter that must no longer be woken; returns false when it was already unlinked to be woken.
+		bool CancelBudgetWait(BudgetWaiter& waiter)
+		{
+			std::lock_guard lock(budgetWaitersMutex_);
+			for (BudgetWaiter** link = &budgetWaiters_; *link; link = &(*link)->next)
+			{
+				if (*link == &waiter)
+				{
+					*link = waiter.next;
+					hasBudgetWaiters_.store(budgetWaiters_ != nullptr);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Requests counted since construction on every thread; empty unless the allocator records a size histogram.
+		[[nodiscard]]
+		SizeHistogram GetSizeHistogram()
+		{
+			SizeHistogram histogram;
+			if (!configuration_.recordSizeHistogram)
+			{
+				return histogram;
+			}
+
+			std::vector<std::size_t> counts = droppedSizeHistogram_;
+			counts.resize(SizeHistogramLength);
+			{
+				std::lock_guard lock(poolsMutex_);
+				for (const ThreadLocalPool* pool : threadPools_ | std::views::values)
+				{
+					AddSizeHistogram(counts, *pool);
+				}
+				for (const ThreadLocalPool* pool : orphanedPools_)
+				{
+					AddSizeHistogram(counts, *pool);
+				}
+			}
+
+			for (std::size_t step = 0; step + 1 < SizeHistogramLength; ++step)
 			{
-				ownerPool->PushRemoteFree(rawPtr, poolIndex);
+				if (counts[step] != 0)
+				{
+					histogram.sizes.push_back({ step * Details::PoolGranuleSize, counts[step] });
+				}
+			}
+			histogram.largeCount = counts.back();
+			return histogram;
+		}
+
+		[[nodiscard]]
+		std::span<const std::size_t> GetPoolSizes() const noexcept
+		{
+			return poolSizes_;
+		}
+
+		// Like FindPoolIndex, against this allocator's classes.
+		[[nodiscard]]
+		int GetPoolIndex(std::size_t size) const noexcept
+		{
+			if (size > Details::MaxPoolSize)
+			{
+				return -1;
 			}
+			return poolIndexTable_[(size + Details::PoolGranuleSize - 1) / Details::PoolGranuleSize];
 		}
 
 		TaskAllocator CreateTaskAllocator()
@@ -281,6 +1301,10 @@ namespace TKit
 				[](void* context, void* ptr, std::size_t size) {
 					auto* allocator = static_cast<PoolAllocator*>(context);
 					allocator->Deallocate(ptr, size);
+				},
+				[](void* context) {
+					auto* allocator = static_cast<PoolAllocator*>(context);
+					allocator->Flush();
 				}
 			};
 		}
@@ -289,25 +1313,46 @@ namespace TKit
 		PoolAllocator& operator=(const PoolAllocator&) = delete;
 
 	private:
-		[[nodiscard]]
-		static int FindPoolIndex(std::size_t size)
+		ThreadLocalPool* GetOrCreateThreadPool()
 		{
-			for (int i = 0; i < static_cast<int>(PoolSizes.size()); ++i)
+			ThreadExitHook& hook = GetThreadExitHook();
+			if (hook.cache[0].allocatorId == id_)
 			{
-				if (size <= PoolSizes[i])
-				{
-					return i;
-				}
+				return hook.cache[0].pool;
 			}
-			return -1;
+			return FindThreadPool(hook);
 		}
 
-		ThreadLocalPool* GetOrCreateThreadPool()
+		// Only the first allocation of each thread locks, to register its pool; later misses rotate the cache.
+		TASKKIT_NOINLINE ThreadLocalPool* FindThreadPool(ThreadExitHook& hook)
+		{
+			auto& cache = hook.cache;
+			const auto isOwn = [this](const TlsCacheEntry& entry) { return entry.allocatorId == id_; };
+
+			const auto cached = std::find_if(cache.begin() + 1, cache.end(), isOwn);
+			if (cached != cache.end())
+			{
+				std::rotate(cache.begin(), cached, cached + 1);
+				return cache[0].pool;
+			}
+
+			const auto registered = std::find_if(hook.pools.begin(), hook.pools.end(), isOwn);
+			ThreadLocalPool* pool = registered != hook.pools.end() ? registered->pool : RegisterThreadPool(hook);
+
+			std::rotate(cache.begin(), cache.end() - 1, cache.end());
+			cache[0] = { pool, id_ };
+			return pool;
+		}
+
+		ThreadLocalPool* RegisterThreadPool(ThreadExitHook& hook)
 		{
-			thread_local TlsCacheEntry cache = { nullptr, 0 };
-			if (cache.pool && cache.allocatorId == id_)
+			// Entries of destroyed allocators would otherwise pile up in threads that outlive many of them.
 			{
-				return cache.pool;
+				std::lock_guard lock(GetRegistryMutex());
+				std::erase_if(hook.pools, [](const TlsCacheEntry& entry)
+				{
+					return !GetRegistry().contains(entry.allocatorId);
+				});
 			}
 
 			const std::thread::id threadId = std::this_thread::get_id();
@@ -315,27 +1360,240 @@ namespace TKit
 			{
 				std::lock_guard lock(poolsMutex_);
 
-				auto itr = threadPools_.find(threadId);
-				if (itr != threadPools_.end())
+				// An exited thread's pool comes with its free blocks and any remote frees still queued for it.
+				if (!orphanedPools_.empty())
 				{
-					pool = itr->second;
+					pool = orphanedPools_.back();
+					orphanedPools_.pop_back();
+					pool->ownerId.store(threadId, std::memory_order_relaxed);
 				}
 				else
 				{
 					pool = new ThreadLocalPool(this, id_, threadId);
-					threadPools_[threadId] = pool;
 				}
+				threadPools_[threadId] = pool;
 			}
 
-			cache.allocatorId = id_;
-			cache.pool = pool;
-
+			hook.pools.push_back({ pool, id_ });
 			return pool;
 		}
 
+		// Granules past the last class map to -1, which sends those sizes down the large-block path.
+		void BuildPoolIndexTable()
+		{
+			assert(!poolSizes_.empty() && poolSizes_.size() <= MaxSizeClassCount && "PoolAllocator: invalid size class count");
+			for (std::size_t i = 0; i < poolSizes_.size(); ++i)
+			{
+				assert(poolSizes_[i] > 0 && poolSizes_[i] % Details::PoolGranuleSize == 0 &&
+					poolSizes_[i] <= Details::MaxPoolSize && "PoolAllocator: size classes must be multiples of 16 up to 8192");
+				assert((i == 0 || poolSizes_[i - 1] < poolSizes_[i]) && "PoolAllocator: size classes must ascend");
+			}
+
+			std::size_t index = 0;
+			for (std::size_t granule = 0; granule < poolIndexTable_.size(); ++granule)
+			{
+				while (index < poolSizes_.size() && poolSizes_[index] < granule * Details::PoolGranuleSize)
+				{
+					++index;
+				}
+				poolIndexTable_[granule] = index < poolSizes_.size() ? static_cast<std::int8_t>(index) : std::int8_t{-1};
+			}
+		}
+
+		[[nodiscard]]
+		static ThreadStats GetThreadStats(const ThreadLocalPool& pool)
+		{
+			ThreadStats thread;
+			thread.threadId = pool.ownerId.load(std::memory_order_relaxed);
+			thread.sizeClasses.resize(pool.parent->poolSizes_.size());
+			for (std::size_t i = 0; i < thread.sizeClasses.size(); ++i)
+			{
+				const auto& counters = pool.counters[i];
+				SizeClassStats& sizeClass = thread.sizeClasses[i];
+				sizeClass.blockSize = pool.pools[i].blockSize;
+				sizeClass.liveBlocks = counters.liveBlocks.Get();
+				sizeClass.freeBlocks = counters.freeBlocks.Get();
+				sizeClass.slabs = counters.slabs.Get();
+				sizeClass.remoteFreesReceived = counters.remoteFreesReceived.Get();
+				sizeClass.allocations = counters.allocations.Get();
+				sizeClass.wastedBytes = counters.wastedBytes.Get();
+			}
+			thread.largeAllocations = pool.largeAllocations.Get();
+			thread.largeCacheHits = pool.largeCacheHits.Get();
+			thread.largeCachedBytes = pool.largeCachedBytes.Get();
+			return thread;
+		}
+
+		// Works for Stats totals and for folding one ThreadStats into another alike.
+		template<typename Totals>
+		static void AddThreadStats(Totals& totals, const ThreadStats& thread)
+		{
+			if (totals.sizeClasses.size() < thread.sizeClasses.size())
+			{
+				totals.sizeClasses.resize(thread.sizeClasses.size());
+			}
+			for (std::size_t i = 0; i < thread.sizeClasses.size(); ++i)
+			{
+				const SizeClassStats& sizeClass = thread.sizeClasses[i];
+				SizeClassStats& total = totals.sizeClasses[i];
+				total.blockSize = sizeClass.blockSize;
+				total.liveBlocks += sizeClass.liveBlocks;
+				total.freeBlocks += sizeClass.freeBlocks;
+				total.slabs += sizeClass.slabs;
+				total.remoteFreesReceived += sizeClass.remoteFreesReceived;
+				total.allocations += sizeClass.allocations;
+				total.wastedBytes += sizeClass.wastedBytes;
+				if constexpr (std::is_same_v<Totals, Stats>)
+				{
+					totals.reservedBytes += sizeClass.slabs * SlabSize;
+				}
+			}
+			totals.largeAllocations += thread.largeAllocations;
+			totals.largeCacheHits += thread.largeCacheHits;
+			totals.largeCachedBytes += thread.largeCachedBytes;
+		}
+
+		static void AddSizeHistogram(std::vector<std::size_t>& counts, const ThreadLocalPool& pool)
+		{
+			if (!pool.sizeHistogram)
+			{
+				return;
+			}
+			counts.resize(SizeHistogramLength);
+			for (std::size_t step = 0; step < SizeHistogramLength; ++step)
+			{
+				counts[step] += pool.sizeHistogram[step].Get();
+			}
+		}
+
+		void ChargeBudget(ThreadLocalPool& pool, std::size_t bytes)
+		{
+			if (pool.budgetCredit < bytes)
+			{
+				DrawBudget(pool, bytes);
+			}
+			pool.budgetCredit -= bytes;
+		}
+
+		// A full step that does not fit is retried with just what this allocation lacks before the policy applies.
+		TASKKIT_NOINLINE void DrawBudget(ThreadLocalPool& pool, std::size_t bytes)
+		{
+			const std::size_t needed = bytes - pool.budgetCredit;
+			std::size_t step = std::max(needed, budgetStepSize_);
+			std::size_t usedBytes = budgetUsedBytes_.fetch_add(step) + step;
+			if (usedBytes > configuration_.memoryBudget && step > needed)
+			{
+				budgetUsedBytes_.fetch_sub(step - needed);
+				usedBytes -= step - needed;
+				step = needed;
+			}
+
+			if (usedBytes > configuration_.memoryBudget)
+			{
+				switch (configuration_.memoryBudgetPolicy)
+				{
+				case MemoryBudgetPolicy::Throw:
+					ReturnBudget(step);
+					throw MemoryBudgetExceededError(bytes, usedBytes - step, configuration_.memoryBudget);
+				case MemoryBudgetPolicy::Hook:
+					try
+					{
+						configuration_.memoryBudgetHook(configuration_.memoryBudgetHookContext, bytes, usedBytes - step);
+					}
+					catch (...)
+					{
+						ReturnBudget(step);
+						throw;
+					}
+					break;
+				case MemoryBudgetPolicy::Gate:
+					break;
+				}
+			}
+			pool.budgetCredit += step;
+		}
+
+		// Frees credit the freeing thread, whichever pool the block came from.
+		void ReleaseBudget(ThreadLocalPool& pool, std::size_t bytes)
+		{
+			pool.budgetCredit += bytes;
+			if (pool.budgetCredit > 2 * budgetStepSize_)
+			{
+				const std::size_t excess = pool.budgetCredit - budgetStepSize_;
+				pool.budgetCredit = budgetStepSize_;
+				ReturnBudget(excess);
+			}
+			else if (hasBudgetWaiters_.load(std::memory_order_relaxed))
+			{
+				// Producers are held back, so freed bytes go back at once instead of a step at a time.
+				ReturnBudgetCredit(pool);
+			}
+		}
+
+		void ReturnBudgetCredit(ThreadLocalPool& pool)
+		{
+			if (pool.budgetCredit != 0)
+			{
+				ReturnBudget(std::exchange(pool.budgetCredit, 0));
+			}
+		}
+
+		void ReturnBudget(std::size_t bytes)
+		{
+			const std::size_t usedBytes = budgetUsedBytes_.fetch_sub(bytes) - bytes;
+			if (usedBytes <= configuration_.memoryBudget && hasBudgetWaiters_.load())
+			{
+				WakeBudgetWaiters();
+			}
+		}
+
+		void WakeBudgetWaiters()
+		{
+			BudgetWaiter* waiter = nullptr;
+			{
+				std::lock_guard lock(budgetWaitersMutex_);
+				waiter = std::exchange(budgetWaiters_, nullptr);
+				hasBudgetWaiters_.store(false);
+			}
+
+			while (waiter)
+			{
+				BudgetWaiter* next = waiter->next;
+				waiter->wake(waiter);
+				waiter = next;
+			}
+		}
+
+		// Runs on the exiting owner thread, which may still touch the pool before giving it up.
+		void Orphan(ThreadLocalPool* pool)
+		{
+			pool->FlushRemoteFrees();
+			pool->Trim();
+			ReturnBudgetCredit(*pool);
+			pool->ownerId.store(std::thread::id{}, std::memory_order_relaxed);
+
+			std::lock_guard lock(poolsMutex_);
+			threadPools_.erase(std::this_thread::get_id());
+			orphanedPools_.push_back(pool);
+		}
+
 		std::uint64_t id_;
+		PoolAllocatorConfiguration configuration_;
+		std::vector<std::size_t> poolSizes_;
+		std::array<std::int8_t, Details::MaxPoolSize / Details::PoolGranuleSize + 1> poolIndexTable_{};
 		std::unordered_map<std::thread::id, ThreadLocalPool*> threadPools_;
+		std::vector<ThreadLocalPool*> orphanedPools_;
+		// Cumulative counts of orphaned pools that Trim deleted; guarded by poolsMutex_.
+		ThreadStats droppedPoolStats_;
+		std::vector<std::size_t> droppedSizeHistogram_;
 		std::mutex poolsMutex_;
+		bool hasBudget_ = false;
+		std::size_t budgetStepSize_ = 0;
+		// Bumped by every thread drawing on or returning budget, so kept off the lines above.
+		alignas(Details::CacheLineSize) std::atomic<std::size_t> budgetUsedBytes_{0};
+		std::atomic<bool> hasBudgetWaiters_{false};
+		std::mutex budgetWaitersMutex_;
+		BudgetWaiter* budgetWaiters_ = nullptr;
 	};
 }
 
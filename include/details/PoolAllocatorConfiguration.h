@@ -0,0 +1,120 @@
+#ifndef TASKKIT_POOL_ALLOCATOR_CONFIGURATION_H
+#define TASKKIT_POOL_ALLOCATOR_CONFIGURATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace TKit
+{
+	// What PoolAllocator does when a frame would take live frame memory past PoolAllocatorConfiguration::memoryBudget.
+	enum class MemoryBudgetPolicy
+	{
+		// The allocation throws MemoryBudgetExceededError.
+		Throw,
+		// The hook is called, then the allocation goes ahead unless the hook throws.
+		Hook,
+		// The allocation goes ahead; producers that co_await TaskSystem::WaitForFrameBudget() are held back until
+		// usage is within budget again.
+		Gate
+	};
+
+	using MemoryBudgetHookFunc = void (*)(void* context, std::size_t requestedBytes, std::size_t usedBytes);
+
+	struct PoolAllocatorConfiguration
+	{
+		class Builder;
+
+		std::size_t highWaterMark = SIZE_MAX;
+		std::size_t largeCacheLimit = 64 * 1024;
+		std::size_t largeCacheDepth = 4;
+		std::size_t mappedAllocationThreshold = SIZE_MAX;
+		// Empty selects PoolAllocator::PoolSizes.
+		std::vector<std::size_t> sizeClasses;
+		bool recordSizeHistogram = false;
+		std::size_t memoryBudget = SIZE_MAX;
+		MemoryBudgetPolicy memoryBudgetPolicy = MemoryBudgetPolicy::Throw;
+		void* memoryBudgetHookContext = nullptr;
+		MemoryBudgetHookFunc memoryBudgetHook = nullptr;
+
+		bool operator==(const PoolAllocatorConfiguration&) const = default;
+	};
+
+	class PoolAllocatorConfiguration::Builder
+	{
+	public:
+		Builder() = default;
+
+		// Once a thread's pool holds more slab memory than this and less than half of it is in use, freeing on that
+		// thread trims the fully free slab runs. The default never trims implicitly; PoolAllocator::Trim always can.
+		Builder& WithHighWaterMark(std::size_t bytes)
+		{
+			configuration_.highWaterMark = bytes;
+			return *this;
+		}
+
+		// Frames larger than every size class are rounded up to a power of two and up to depth freed blocks per size are
+		// kept by the freeing thread, for sizes up to limit bytes. A limit of zero disables the cache.
+		Builder& WithLargeCache(std::size_t limit, std::size_t depth)
+		{
+			configuration_.largeCacheLimit = limit;
+			configuration_.largeCacheDepth = depth;
+			return *this;
+		}
+
+		// Uncached frames of at least this many bytes are mapped from the OS directly where mmap is available, and
+		// unmapped as soon as they are freed.
+		Builder& WithMappedAllocationThreshold(std::size_t bytes)
+		{
+			configuration_.mappedAllocationThreshold = bytes;
+			return *this;
+		}
+
+		// Replaces the default size classes with sizes, e.g. from PoolAllocator::FitSizeClasses. They must ascend, be
+		// multiples of 16 no larger than 8192 and number at most PoolAllocator::MaxSizeClassCount; larger frames go to the
+		// large-block path.
+		Builder& WithSizeClasses(std::vector<std::size_t> sizes)
+		{
+			configuration_.sizeClasses = std::move(sizes);
+			return *this;
+		}
+
+		// Counts every request per 16-byte size step, for PoolAllocator::GetSizeHistogram. Costs one counter update per
+		// allocation, so it is meant for profiling runs.
+		Builder& WithSizeHistogram(bool enabled = true)
+		{
+			configuration_.recordSizeHistogram = enabled;
+			return *this;
+		}
+
+		// Caps the bytes held by live frames, block and header sizes included, across all threads. Threads draw on the
+		// budget in steps, so it may be reached while some of it is still unused by other threads.
+		Builder& WithMemoryBudget(std::size_t bytes, MemoryBudgetPolicy policy = MemoryBudgetPolicy::Throw)
+		{
+			configuration_.memoryBudget = bytes;
+			configuration_.memoryBudgetPolicy = policy;
+			return *this;
+		}
+
+		// Required by MemoryBudgetPolicy::Hook. The hook runs on the allocating thread at most once per step drawn past
+		// the budget, and may trim caches, log or throw.
+		Builder& WithMemoryBudgetHook(void* context, MemoryBudgetHookFunc hook)
+		{
+			configuration_.memoryBudgetHookContext = context;
+			configuration_.memoryBudgetHook = hook;
+			return *this;
+		}
+
+		[[nodiscard]]
+		PoolAllocatorConfiguration Build() const
+		{
+			return configuration_;
+		}
+
+	private:
+		PoolAllocatorConfiguration configuration_;
+	};
+}
+
+#endif //TASKKIT_POOL_ALLOCATOR_CONFIGURATION_H
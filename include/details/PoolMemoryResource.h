@@ -0,0 +1,67 @@
+#ifndef TASKKIT_POOL_MEMORY_RESOURCE_H
+#define TASKKIT_POOL_MEMORY_RESOURCE_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include "PoolAllocator.h"
+
+namespace TKit
+{
+	// Serves std::pmr containers from a PoolAllocator, so temporaries built inside tasks share the thread-local pools and
+	// remote-free batching of the frames. Pool blocks are max-aligned; over-aligned requests are padded within the pool
+	// and keep their block's address in the word before the returned pointer.
+	class PoolMemoryResource final : public std::pmr::memory_resource
+	{
+	public:
+		explicit PoolMemoryResource(PoolAllocator& allocator) noexcept :
+			allocator_(&allocator)
+		{
+		}
+
+		[[nodiscard]]
+		PoolAllocator& GetAllocator() const noexcept
+		{
+			return *allocator_;
+		}
+
+	private:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			if (alignment <= alignof(std::max_align_t))
+			{
+				return allocator_->Allocate(bytes);
+			}
+
+			void* block = allocator_->Allocate(bytes + alignment);
+			const auto address = reinterpret_cast<std::uintptr_t>(block) + sizeof(void*);
+			auto* aligned = reinterpret_cast<void**>((address + alignment - 1) & ~(alignment - 1));
+			aligned[-1] = block;
+			return aligned;
+		}
+
+		void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
+		{
+			if (alignment <= alignof(std::max_align_t))
+			{
+				allocator_->Deallocate(ptr, bytes);
+				return;
+			}
+
+			allocator_->Deallocate(static_cast<void**>(ptr)[-1], bytes + alignment);
+		}
+
+		[[nodiscard]]
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			const auto* resource = dynamic_cast<const PoolMemoryResource*>(&other);
+			return resource && resource->allocator_ == allocator_;
+		}
+
+		PoolAllocator* allocator_;
+	};
+}
+
+#endif //TASKKIT_POOL_MEMORY_RESOURCE_H
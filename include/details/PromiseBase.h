@@ -1,6 +1,8 @@
 ﻿#ifndef TASKKIT_PROMISE_BASE_H
 #define TASKKIT_PROMISE_BASE_H
+#include <exception>
 #include <future>
+#include <variant>
 
 namespace TKit
 {
@@ -0,0 +1,254 @@
+#ifndef TASKKIT_REMOTE_QUEUE_H
+#define TASKKIT_REMOTE_QUEUE_H
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include "CacheLine.h"
+
+namespace TKit
+{
+	// Bounded multi-producer multi-consumer ring (Vyukov) with an allocated overflow list.
+	// Pushes and pops touch only preallocated cells; the overflow list is allocated only while the ring is full.
+	// Entries pushed during an overflow may be popped out of order with respect to the ring.
+	template<typename T>
+	class RemoteQueue final
+	{
+		struct Cell
+		{
+			std::atomic<std::size_t> sequence;
+			T value;
+		};
+
+		struct OverflowNode
+		{
+			OverflowNode* next;
+			T value;
+		};
+
+	public:
+		explicit RemoteQueue(std::size_t capacity) :
+			mask_(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity) - 1),
+			cells_(std::make_unique<Cell[]>(mask_ + 1))
+		{
+			for (std::size_t i = 0; i <= mask_; ++i)
+			{
+				cells_[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		~RemoteQueue()
+		{
+			DeleteOverflow(overflowHead_.load(std::memory_order_acquire));
+		}
+
+		// Any thread.
+		void Push(T value)
+		{
+			if (!TryPushRing(value))
+			{
+				PushOverflow(value);
+			}
+		}
+
+		// Any thread. Pops up to one ring's worth of entries, then the whole overflow list, and returns how many were popped.
+		// The bound keeps a consumer from being held forever by producers that keep refilling the ring.
+		template<typename Func>
+		std::size_t Drain(Func&& func)
+		{
+			if (!cells_)
+			{
+				return 0;
+			}
+
+			std::size_t count = 0;
+			T value;
+			while (count <= mask_ && TryPopRing(value))
+			{
+				func(value);
+				++count;
+			}
+
+			if (overflowHead_.load(std::memory_order_relaxed) == nullptr)
+			{
+				return count;
+			}
+
+			OverflowNode* node = overflowHead_.exchange(nullptr, std::memory_order_acquire);
+			OverflowNode* reversed = nullptr;
+			while (node)
+			{
+				OverflowNode* next = node->next;
+				node->next = reversed;
+				reversed = node;
+				node = next;
+			}
+
+			while (reversed)
+			{
+				OverflowNode* next = reversed->next;
+				func(reversed->value);
+				delete reversed;
+				reversed = next;
+				++count;
+			}
+			return count;
+		}
+
+		// Counts entries whose push has started, so it may briefly overestimate while a push is in flight.
+		[[nodiscard]]
+		std::size_t GetApproximateSize() const noexcept
+		{
+			const std::size_t enqueue = enqueuePosition_.load(std::memory_order_relaxed);
+			const std::size_t dequeue = dequeuePosition_.load(std::memory_order_relaxed);
+			std::size_t count = enqueue > dequeue ? enqueue - dequeue : 0;
+
+			const OverflowNode* node = overflowHead_.load(std::memory_order_acquire);
+			while (node)
+			{
+				++count;
+				node = node->next;
+			}
+			return count;
+		}
+
+		[[nodiscard]]
+		bool IsEmpty() const noexcept
+		{
+			return enqueuePosition_.load(std::memory_order_relaxed) == dequeuePosition_.load(std::memory_order_relaxed) &&
+			       overflowHead_.load(std::memory_order_relaxed) == nullptr;
+		}
+
+		[[nodiscard]]
+		std::size_t GetCapacity() const noexcept
+		{
+			return mask_ + 1;
+		}
+
+		RemoteQueue(const RemoteQueue&) = delete;
+		RemoteQueue& operator=(const RemoteQueue&) = delete;
+
+		// Moving is only valid while no other thread is using either queue; the moved-from queue may only be destroyed or assigned to.
+		RemoteQueue(RemoteQueue&& other) noexcept :
+			mask_(other.mask_),
+			cells_(std::move(other.cells_)),
+			enqueuePosition_(other.enqueuePosition_.load(std::memory_order_relaxed)),
+			dequeuePosition_(other.dequeuePosition_.load(std::memory_order_relaxed)),
+			overflowHead_(other.overflowHead_.exchange(nullptr, std::memory_order_acquire))
+		{
+			other.enqueuePosition_.store(0, std::memory_order_relaxed);
+			other.dequeuePosition_.store(0, std::memory_order_relaxed);
+		}
+
+		RemoteQueue& operator=(RemoteQueue&& other) noexcept
+		{
+			if (this != &other)
+			{
+				DeleteOverflow(overflowHead_.exchange(nullptr, std::memory_order_acquire));
+
+				mask_ = other.mask_;
+				cells_ = std::move(other.cells_);
+				enqueuePosition_.store(other.enqueuePosition_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				dequeuePosition_.store(other.dequeuePosition_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				overflowHead_.store(other.overflowHead_.exchange(nullptr, std::memory_order_acquire), std::memory_order_release);
+				other.enqueuePosition_.store(0, std::memory_order_relaxed);
+				other.dequeuePosition_.store(0, std::memory_order_relaxed);
+			}
+			return *this;
+		}
+
+	private:
+		bool TryPushRing(const T& value) noexcept
+		{
+			std::size_t position = enqueuePosition_.load(std::memory_order_relaxed);
+			while (true)
+			{
+				Cell& cell = cells_[position & mask_];
+				const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+
+				if (difference == 0)
+				{
+					if (enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						cell.value = value;
+						cell.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (difference < 0)
+				{
+					return false;
+				}
+				else
+				{
+					position = enqueuePosition_.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		bool TryPopRing(T& value) noexcept
+		{
+			std::size_t position = dequeuePosition_.load(std::memory_order_relaxed);
+			while (true)
+			{
+				Cell& cell = cells_[position & mask_];
+				const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				const auto difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+
+				if (difference == 0)
+				{
+					if (dequeuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						value = cell.value;
+						cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (difference < 0)
+				{
+					return false;
+				}
+				else
+				{
+					position = dequeuePosition_.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		void PushOverflow(const T& value)
+		{
+			auto* node = new OverflowNode{nullptr, value};
+
+			OverflowNode* oldHead = overflowHead_.load(std::memory_order_relaxed);
+			do
+			{
+				node->next = oldHead;
+			} while (!overflowHead_.compare_exchange_weak(
+				oldHead, node,
+				std::memory_order_release,
+				std::memory_order_relaxed));
+		}
+
+		static void DeleteOverflow(OverflowNode* node) noexcept
+		{
+			while (node)
+			{
+				OverflowNode* next = node->next;
+				delete node;
+				node = next;
+			}
+		}
+
+		std::size_t mask_;
+		std::unique_ptr<Cell[]> cells_;
+		// Producers and consumers each bump their own position on its own line. Producers only touch the overflow head
+		// while the ring is full, so it rides along with the consumer's position, which checks it on every drain.
+		alignas(Details::CacheLineSize) std::atomic<std::size_t> enqueuePosition_{0};
+		alignas(Details::CacheLineSize) std::atomic<std::size_t> dequeuePosition_{0};
+		std::atomic<OverflowNode*> overflowHead_{nullptr};
+	};
+}
+
+#endif //TASKKIT_REMOTE_QUEUE_H
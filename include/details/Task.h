@@ -1,16 +1,22 @@
 ﻿#ifndef TASKKIT_TASK_H
 #define TASKKIT_TASK_H
 
+#include <atomic>
 #include <coroutine>
+#include <cstdint>
 #include <variant>
 #include <cstdio>
 #include "PromiseBase.h"
 #include "PromiseContext.h"
 #include "AwaitTransformer.h"
+#include "TaskAllocatorPolicy.h"
 
 namespace TKit
 {
-	template<typename = void>
+	// Runs in place of an awaiter when a task completes; the returned handle is resumed next.
+	using TaskCompletionHandler = std::coroutine_handle<> (*)(void* context) noexcept;
+
+	template<typename T = void>
 	class [[nodiscard]] Task final
 	{
 	public:
@@ -35,21 +41,38 @@ namespace TKit
 				return;
 			}
 
-			if (handle_.promise().IsReady())
+			if (!handle_.promise().Detach())
 			{
 				handle_.destroy();
-				handle_ = nullptr;
-				return;
 			}
-
-			handle_.promise().MarkAsForgotten();
 			handle_ = nullptr;
 		}
 
 		[[nodiscard]]
 		bool IsReady() const noexcept
 		{
-			return !handle_ || handle_.promise().IsReady();
+			return !handle_ || handle_.promise().IsCompleted();
+		}
+
+		// Lets a combinator watch several tasks without a coroutine per task: handler runs on the thread that completes
+		// this task, in place of a continuation. Returns false without registering if the task has already completed.
+		// The task still owns its frame and must stay alive until the handler has run.
+		bool OnCompleted(TaskCompletionHandler handler, void* context) noexcept
+		{
+			return handle_.promise().OnCompleted(handler, context);
+		}
+
+		// Returns the result of a completed task, rethrowing its exception if it failed.
+		T GetResult()
+		{
+			if constexpr (std::is_void_v<T>)
+			{
+				handle_.promise().Get();
+			}
+			else
+			{
+				return handle_.promise().Get();
+			}
 		}
 
 		[[nodiscard]]
@@ -106,12 +129,13 @@ namespace TKit
 		[[nodiscard]]
 		bool await_ready() const noexcept
 		{
-			return GetPromise().IsReady();
+			return GetPromise().IsCompleted();
 		}
 
-		void await_suspend(std::coroutine_handle<> awaitingHandle) noexcept
+		// Resumes immediately if the task completed on another thread after await_ready.
+		bool await_suspend(std::coroutine_handle<> awaitingHandle) noexcept
 		{
-			GetPromise().SetContinuation(awaitingHandle);
+			return GetPromise().OnCompleted(awaitingHandle);
 		}
 
 		T await_resume()
@@ -139,31 +163,51 @@ namespace TKit
 	template<typename T>
 	class Task<T>::Promise final : public PromiseBase<T>
 	{
+		// Completion may happen on another thread than registration, so the hand-off goes through one atomic.
+		enum class State : std::uint8_t
+		{
+			Pending,
+			Registered,
+			Forgotten,
+			Completed,
+		};
+
 	public:
 		void* operator new(std::size_t size)
 		{
-			return PromiseContext::GetCurrent().GetAllocator().Allocate(size);
+			return TaskAllocatorPolicy::Allocate(size);
 		}
 
 		void operator delete(void* ptr, std::size_t size) noexcept
 		{
-			PromiseContext::GetCurrent().GetAllocator().Deallocate(ptr, size);
+			TaskAllocatorPolicy::Deallocate(ptr, size);
 		}
 
 		[[nodiscard]]
-		std::coroutine_handle<> GetContinuation() const noexcept
+		bool IsCompleted() const noexcept
 		{
-			return continuation_ ? continuation_ : std::noop_coroutine();
+			return state_.load(std::memory_order_acquire) == State::Completed;
 		}
 
-		void SetContinuation(std::coroutine_handle<> continuation) noexcept
+		// Each returns false without registering when the task has already completed.
+		bool OnCompleted(std::coroutine_handle<> continuation) noexcept
 		{
 			continuation_ = continuation;
+			return TryRegister();
+		}
+
+		bool OnCompleted(TaskCompletionHandler handler, void* context) noexcept
+		{
+			completionHandler_ = handler;
+			completionContext_ = context;
+			return TryRegister();
 		}
 
-		void MarkAsForgotten() noexcept
+		// The frame destroys itself on completion. Returns false when it has already completed and the caller must destroy it.
+		bool Detach() noexcept
 		{
-			isForgotten_ = true;
+			auto expected = State::Pending;
+			return state_.compare_exchange_strong(expected, State::Forgotten, std::memory_order_acq_rel, std::memory_order_acquire);
 		}
 
 		template<Awaitable U>
@@ -203,12 +247,20 @@ namespace TKit
 				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
 				{
 					auto& promise = handle.promise();
-					if (promise.isForgotten_)
+					switch (promise.state_.exchange(State::Completed, std::memory_order_acq_rel))
 					{
+					case State::Forgotten:
 						handle.destroy();
 						return std::noop_coroutine();
+					case State::Registered:
+						if (promise.completionHandler_)
+						{
+							return promise.completionHandler_(promise.completionContext_);
+						}
+						return promise.continuation_;
+					default:
+						return std::noop_coroutine();
 					}
-					return promise.GetContinuation();
 				}
 
 				void await_resume() noexcept
@@ -220,8 +272,16 @@ namespace TKit
 		}
 
 	private:
+		bool TryRegister() noexcept
+		{
+			auto expected = State::Pending;
+			return state_.compare_exchange_strong(expected, State::Registered, std::memory_order_acq_rel, std::memory_order_acquire);
+		}
+
 		std::coroutine_handle<> continuation_;
-		bool isForgotten_ = false;
+		TaskCompletionHandler completionHandler_ = nullptr;
+		void* completionContext_ = nullptr;
+		std::atomic<State> state_{State::Pending};
 	};
 
 	template<typename T>
@@ -11,15 +11,18 @@ namespace TKit
 	public:
 		using AllocateFunc = void* (*)(void* context, std::size_t size);
 		using DeallocateFunc = void (*)(void* context, void* ptr, std::size_t size);
+		using FlushFunc = void (*)(void* context);
 
 		TaskAllocator() : TaskAllocator(nullptr, nullptr, nullptr)
 		{
 		}
 
-		TaskAllocator(void* context, AllocateFunc allocate, DeallocateFunc deallocate) :
+		// flush is optional and publishes work the allocator deferred on the calling thread, such as batched frees.
+		TaskAllocator(void* context, AllocateFunc allocate, DeallocateFunc deallocate, FlushFunc flush = nullptr) :
 			context_(context),
 			allocate_(allocate),
-			deallocate_(deallocate)
+			deallocate_(deallocate),
+			flush_(flush)
 		{
 			if (!allocate_)
 			{
@@ -49,6 +52,14 @@ namespace TKit
 			deallocate_(context_, ptr, size);
 		}
 
+		void Flush() const
+		{
+			if (flush_)
+			{
+				flush_(context_);
+			}
+		}
+
 		[[nodiscard]]
 		void* GetContext() const noexcept
 		{
@@ -59,6 +70,7 @@ namespace TKit
 		void* context_;
 		AllocateFunc allocate_;
 		DeallocateFunc deallocate_;
+		FlushFunc flush_;
 	};
 }
 
@@ -0,0 +1,84 @@
+#ifndef TASKKIT_TASK_ALLOCATOR_POLICY_H
+#define TASKKIT_TASK_ALLOCATOR_POLICY_H
+
+#include <concepts>
+#include <cstddef>
+#include "PoolAllocator.h"
+#include "PromiseContext.h"
+#include "TaskAllocator.h"
+
+namespace TKit
+{
+	// Resolves the TaskAllocator configured on the TaskSystem at run time, through two indirect calls per frame.
+	struct DynamicAllocatorPolicy
+	{
+		static void* Allocate(std::size_t size)
+		{
+			return PromiseContext::GetCurrent().GetAllocator().Allocate(size);
+		}
+
+		static void Deallocate(void* ptr, std::size_t size) noexcept
+		{
+			PromiseContext::GetCurrent().GetAllocator().Deallocate(ptr, size);
+		}
+	};
+
+	// Binds frames to one process-wide PoolAllocator at compile time, so allocation inlines down to the calling thread's
+	// free list. A policy exposing GetPoolAllocator() also becomes the TaskSystem's default allocator, which keeps
+	// TrimAllocator and prewarmed frames working; define a policy like this one to configure the pool.
+	struct PoolAllocatorPolicy
+	{
+		[[nodiscard]]
+		static PoolAllocator& GetPoolAllocator()
+		{
+			static PoolAllocator allocator;
+			return allocator;
+		}
+
+		static void* Allocate(std::size_t size)
+		{
+			return GetPoolAllocator().Allocate(size);
+		}
+
+		static void Deallocate(void* ptr, std::size_t size) noexcept
+		{
+			GetPoolAllocator().Deallocate(ptr, size);
+		}
+	};
+}
+
+// Define before including TaskKit, identically in every translation unit, to name a type with static Allocate(size) and
+// Deallocate(ptr, size) that every task frame goes through.
+#ifndef TASKKIT_ALLOCATOR
+#define TASKKIT_ALLOCATOR ::TKit::DynamicAllocatorPolicy
+#endif
+
+namespace TKit
+{
+	using TaskAllocatorPolicy = TASKKIT_ALLOCATOR;
+
+	namespace Details
+	{
+		template<typename Policy>
+		concept PoolAllocatorBackedPolicy = requires
+		{
+			{ Policy::GetPoolAllocator() } -> std::same_as<PoolAllocator&>;
+		};
+
+		template<typename Policy>
+		[[nodiscard]]
+		PoolAllocator* GetPolicyPoolAllocator()
+		{
+			if constexpr (PoolAllocatorBackedPolicy<Policy>)
+			{
+				return &Policy::GetPoolAllocator();
+			}
+			else
+			{
+				return nullptr;
+			}
+		}
+	}
+}
+
+#endif //TASKKIT_TASK_ALLOCATOR_POLICY_H
@@ -0,0 +1,19 @@
+#ifndef TASKKIT_TASK_PRIORITY_H
+#define TASKKIT_TASK_PRIORITY_H
+#include <cstddef>
+#include <cstdint>
+
+namespace TKit
+{
+	// Lanes of a TaskScheduler; Update drains them in declaration order.
+	enum class TaskPriority : std::uint8_t
+	{
+		High,
+		Normal,
+		Low,
+	};
+
+	inline constexpr std::size_t TaskPriorityCount = 3;
+}
+
+#endif //TASKKIT_TASK_PRIORITY_H
@@ -1,87 +1,301 @@
 #ifndef TASKKIT_TASK_SCHEDULER_H
 #define TASKKIT_TASK_SCHEDULER_H
 
+#include <array>
 #include <atomic>
+#include <cassert>
+#include <chrono>
 #include <coroutine>
+#include <cstdint>
 #include <vector>
 #include <thread>
+#include <utility>
+#include "CacheLine.h"
+#include "RemoteQueue.h"
+#include "TaskAllocator.h"
+#include "TaskPriority.h"
 
 namespace TKit
 {
 	class TaskScheduler final
 	{
-		struct RemoteNode
+		struct Lane
+		{
+			[[nodiscard]]
+			std::size_t GetDeferredCount() const noexcept
+			{
+				return updateHandles.size() - updateCursor;
+			}
+
+			std::vector<std::coroutine_handle<>> handles;
+			std::vector<std::coroutine_handle<>> updateHandles;
+			std::size_t updateCursor = 0;
+			std::size_t starvedUpdates = 0;
+		};
+
+		struct RemoteEntry
 		{
-			RemoteNode* next;
 			std::coroutine_handle<> handle;
+			TaskPriority priority = TaskPriority::Normal;
 		};
 
 	public:
-		explicit TaskScheduler(std::size_t reservedTaskCount, std::thread::id ownerId = std::thread::id{}) :
-			ownerId_(ownerId == std::thread::id{} ? std::this_thread::get_id() : ownerId)
+		using Clock = std::chrono::steady_clock;
+
+		class Timer final
 		{
-			handles_.reserve(reservedTaskCount);
-			updateHandles_.reserve(reservedTaskCount);
+		public:
+			Timer(Clock::time_point deadline, std::coroutine_handle<> handle) noexcept :
+				deadline_(deadline),
+				handle_(handle)
+			{
+			}
+
+			[[nodiscard]]
+			Clock::time_point GetDeadline() const noexcept
+			{
+				return deadline_;
+			}
+
+			[[nodiscard]]
+			std::coroutine_handle<> GetHandle() const noexcept
+			{
+				return handle_;
+			}
+
+			// The lane the handle returns to on expiry, inherited from the lane that scheduled the timer.
+			[[nodiscard]]
+			TaskPriority GetPriority() const noexcept
+			{
+				return priority_;
+			}
+
+			[[nodiscard]]
+			bool IsScheduled() const noexcept
+			{
+				return heapIndex_ != InvalidIndex;
+			}
+
+			// Returns true for exactly one caller, whether it is the scheduler on expiry or an early wake-up.
+			[[nodiscard]]
+			bool TryClaim() noexcept
+			{
+				return !claimed_.exchange(true, std::memory_order_acq_rel);
+			}
+
+			Timer(const Timer&) = delete;
+			Timer& operator=(const Timer&) = delete;
+			Timer(Timer&&) = delete;
+			Timer& operator=(Timer&&) = delete;
+
+		private:
+			friend class TaskScheduler;
+
+			static constexpr std::size_t InvalidIndex = ~std::size_t{0};
+
+			Clock::time_point deadline_;
+			std::coroutine_handle<> handle_;
+			std::size_t heapIndex_ = InvalidIndex;
+			std::uint64_t sequence_ = 0;
+			TaskPriority priority_ = TaskPriority::Normal;
+			std::atomic<bool> claimed_{false};
+		};
+
+		// A lane that is deferred by this many consecutive UpdateFor calls gets one handle resumed ahead of the others.
+		static constexpr std::size_t LaneStarvationLimit = 4;
+
+		// The allocator is flushed after every update, so frames freed while resuming are handed back in one go.
+		explicit TaskScheduler(
+			std::size_t reservedTaskCount,
+			std::thread::id ownerId = std::thread::id{},
+			const TaskAllocator& allocator = TaskAllocator{}
+		) :
+			ownerId_(ownerId == std::thread::id{} ? std::this_thread::get_id() : ownerId),
+			allocator_(allocator),
+			remoteQueue_(reservedTaskCount)
+		{
+			for (auto& lane : lanes_)
+			{
+				lane.handles.reserve(reservedTaskCount);
+				lane.updateHandles.reserve(reservedTaskCount);
+			}
 		}
 
 		~TaskScheduler()
 		{
-			for (const auto& handle : handles_)
+			for (auto& lane : lanes_)
+			{
+				for (const auto& handle : lane.handles)
+				{
+					handle.destroy();
+				}
+				for (std::size_t i = lane.updateCursor; i < lane.updateHandles.size(); ++i)
+				{
+					lane.updateHandles[i].destroy();
+				}
+			}
+
+			const auto timers = std::move(timers_);
+			for (Timer* timer : timers)
+			{
+				timer->heapIndex_ = Timer::InvalidIndex;
+			}
+			for (Timer* timer : timers)
 			{
-				handle.destroy();
+				timer->handle_.destroy();
 			}
-			for (const auto& handle : updateHandles_)
+
+			remoteQueue_.Drain([](const RemoteEntry& entry) { entry.handle.destroy(); });
+		}
+
+		// Drains every lane, highest priority first.
+		void Update()
+		{
+			PrepareUpdate();
+
+			std::size_t count = 0;
+			for (const auto& lane : lanes_)
 			{
-				handle.destroy();
+				count += lane.GetDeferredCount();
 			}
+			pendingCount_.fetch_sub(count, std::memory_order_relaxed);
 
-			RemoteNode* head = remoteHead_.load(std::memory_order_acquire);
-			while (head)
+			for (std::size_t i = 0; i < TaskPriorityCount; ++i)
 			{
-				RemoteNode* current = head;
-				head = head->next;
-				current->handle.destroy();
-				delete current;
+				auto& lane = lanes_[i];
+				while (lane.updateCursor < lane.updateHandles.size())
+				{
+					ResumeNext(i);
+				}
+				lane.updateHandles.clear();
+				lane.updateCursor = 0;
+				lane.starvedUpdates = 0;
 			}
+			currentPriority_ = TaskPriority::Normal;
+			allocator_.Flush();
 		}
 
-		void Update()
+		// Stops resuming once the budget is spent and returns how many handles were deferred.
+		// Deferred handles run first in their lane on the next update, in their original order. Higher lanes go first,
+		// except that a starved lane gets one handle resumed up front. At least one handle is always resumed.
+		std::size_t UpdateFor(std::chrono::nanoseconds budget)
 		{
-			CollectRemote();
-			std::swap(updateHandles_, handles_);
+			PrepareUpdate();
+			const auto deadline = Clock::now() + budget;
 
-			for (const auto& handle : updateHandles_)
+			std::size_t resumedCount = 0;
+			for (std::size_t i = 0; i < TaskPriorityCount; ++i)
 			{
-				handle.resume();
+				if (lanes_[i].starvedUpdates >= LaneStarvationLimit && lanes_[i].GetDeferredCount() > 0)
+				{
+					ResumeNext(i);
+					++resumedCount;
+				}
 			}
-			updateHandles_.clear();
+
+			bool budgetSpent = false;
+			for (std::size_t i = 0; i < TaskPriorityCount && !budgetSpent; ++i)
+			{
+				auto& lane = lanes_[i];
+				while (lane.updateCursor < lane.updateHandles.size())
+				{
+					if (resumedCount > 0 && Clock::now() >= deadline)
+					{
+						budgetSpent = true;
+						break;
+					}
+
+					ResumeNext(i);
+					++resumedCount;
+				}
+			}
+			currentPriority_ = TaskPriority::Normal;
+			pendingCount_.fetch_sub(resumedCount, std::memory_order_relaxed);
+
+			std::size_t deferredCount = 0;
+			for (auto& lane : lanes_)
+			{
+				const std::size_t laneDeferredCount = lane.GetDeferredCount();
+				if (laneDeferredCount == 0)
+				{
+					lane.updateHandles.clear();
+					lane.updateCursor = 0;
+					lane.starvedUpdates = 0;
+				}
+				else
+				{
+					lane.starvedUpdates = lane.updateCursor == 0 ? lane.starvedUpdates + 1 : 0;
+				}
+				deferredCount += laneDeferredCount;
+			}
+			allocator_.Flush();
+			return deferredCount;
 		}
 
+		// From the owner thread the handle inherits the lane that is currently being resumed; otherwise it runs as Normal.
 		void Schedule(std::coroutine_handle<> handle)
 		{
 			if (std::this_thread::get_id() == ownerId_)
 			{
-				handles_.emplace_back(handle);
+				pendingCount_.fetch_add(1, std::memory_order_relaxed);
+				lanes_[static_cast<std::size_t>(currentPriority_)].handles.emplace_back(handle);
+			}
+			else
+			{
+				Schedule(handle, TaskPriority::Normal);
+			}
+		}
+
+		void Schedule(std::coroutine_handle<> handle, TaskPriority priority)
+		{
+			pendingCount_.fetch_add(1, std::memory_order_relaxed);
+			if (std::this_thread::get_id() == ownerId_)
+			{
+				lanes_[static_cast<std::size_t>(priority)].handles.emplace_back(handle);
 			}
 			else
 			{
-				PushRemote(handle);
+				remoteQueue_.Push(RemoteEntry{ handle, priority });
 			}
 		}
 
+		// The lane of the handle being resumed, or Normal outside of an update. Owner thread only.
 		[[nodiscard]]
-		std::size_t GetPendingTaskCount() const
+		TaskPriority GetCurrentPriority() const noexcept
+		{
+			return currentPriority_;
+		}
+
+		// Parks the timer's handle until its deadline; it costs nothing per Update until it expires.
+		void ScheduleTimer(Timer& timer)
+		{
+			assert(std::this_thread::get_id() == ownerId_ && "TaskScheduler: timers must be scheduled from the owner thread");
+			assert(!timer.IsScheduled() && "TaskScheduler: timer is already scheduled");
+
+			pendingCount_.fetch_add(1, std::memory_order_relaxed);
+			timer.sequence_ = nextTimerSequence_++;
+			timer.priority_ = currentPriority_;
+			timer.heapIndex_ = timers_.size();
+			timers_.emplace_back(&timer);
+			SiftUpTimer(timer.heapIndex_);
+		}
+
+		void CancelTimer(Timer& timer)
 		{
-			std::size_t count = handles_.size();
+			assert(std::this_thread::get_id() == ownerId_ && "TaskScheduler: timers must be cancelled from the owner thread");
 
-			RemoteNode* node = remoteHead_.load(std::memory_order_acquire);
-			while (node)
+			if (timer.IsScheduled())
 			{
-				++count;
-				node = node->next;
+				RemoveTimerAt(timer.heapIndex_);
 			}
+		}
 
-			return count;
+		// Constant time and safe from any thread. Counts handles waiting for the next Update, parked timers and
+		// remote submissions; a remote Schedule is counted as soon as it starts.
+		[[nodiscard]]
+		std::size_t GetPendingTaskCount() const noexcept
+		{
+			return pendingCount_.load(std::memory_order_relaxed);
 		}
 
 		TaskScheduler(const TaskScheduler&) = delete;
@@ -89,9 +303,13 @@ namespace TKit
 
 		TaskScheduler(TaskScheduler&& other) noexcept :
 			ownerId_(other.ownerId_),
-			handles_(std::move(other.handles_)),
-			updateHandles_(std::move(other.updateHandles_)),
-			remoteHead_(other.remoteHead_.exchange(nullptr, std::memory_order_acquire))
+			allocator_(other.allocator_),
+			lanes_(std::move(other.lanes_)),
+			currentPriority_(other.currentPriority_),
+			timers_(std::move(other.timers_)),
+			nextTimerSequence_(other.nextTimerSequence_),
+			remoteQueue_(std::move(other.remoteQueue_)),
+			pendingCount_(other.pendingCount_.exchange(0, std::memory_order_relaxed))
 		{
 		}
 
@@ -100,55 +318,162 @@ namespace TKit
 			if (this != &other)
 			{
 				ownerId_ = other.ownerId_;
-				handles_ = std::move(other.handles_);
-				updateHandles_ = std::move(other.updateHandles_);
+				allocator_ = other.allocator_;
+				lanes_ = std::move(other.lanes_);
+				currentPriority_ = other.currentPriority_;
+				timers_ = std::move(other.timers_);
+				nextTimerSequence_ = other.nextTimerSequence_;
+				remoteQueue_ = std::move(other.remoteQueue_);
+				pendingCount_.store(other.pendingCount_.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+			}
+			return *this;
+		}
 
-				RemoteNode* oldHead = remoteHead_.exchange(nullptr, std::memory_order_acquire);
-				while (oldHead)
+	private:
+		// Queues this update's handles behind any carried over by a previous UpdateFor, lane by lane.
+		void PrepareUpdate()
+		{
+			CollectRemote();
+			ExpireTimers();
+
+			for (auto& lane : lanes_)
+			{
+				if (lane.updateCursor == lane.updateHandles.size())
+				{
+					lane.updateHandles.clear();
+					lane.updateCursor = 0;
+					std::swap(lane.updateHandles, lane.handles);
+				}
+				else
 				{
-					RemoteNode* next = oldHead->next;
-					delete oldHead;
-					oldHead = next;
+					lane.updateHandles.erase(
+						lane.updateHandles.begin(),
+						lane.updateHandles.begin() + static_cast<std::ptrdiff_t>(lane.updateCursor));
+					lane.updateCursor = 0;
+					lane.updateHandles.insert(lane.updateHandles.end(), lane.handles.begin(), lane.handles.end());
+					lane.handles.clear();
 				}
-				remoteHead_.store(
-					other.remoteHead_.exchange(nullptr, std::memory_order_acquire),
-					std::memory_order_release
-				);
 			}
-			return *this;
 		}
 
-	private:
+		void ResumeNext(std::size_t laneIndex)
+		{
+			auto& lane = lanes_[laneIndex];
+			currentPriority_ = static_cast<TaskPriority>(laneIndex);
+			lane.updateHandles[lane.updateCursor++].resume();
+		}
+
 		void CollectRemote()
 		{
-			RemoteNode* head = remoteHead_.exchange(nullptr, std::memory_order_acquire);
-			while (head)
+			remoteQueue_.Drain([this](const RemoteEntry& entry)
+			{
+				lanes_[static_cast<std::size_t>(entry.priority)].handles.emplace_back(entry.handle);
+			});
+		}
+
+		void ExpireTimers()
+		{
+			if (timers_.empty())
+			{
+				return;
+			}
+
+			const auto now = Clock::now();
+			while (!timers_.empty() && timers_.front()->deadline_ <= now)
+			{
+				Timer* timer = timers_.front();
+				RemoveTimerAt(0);
+
+				if (timer->TryClaim())
+				{
+					pendingCount_.fetch_add(1, std::memory_order_relaxed);
+					lanes_[static_cast<std::size_t>(timer->priority_)].handles.emplace_back(timer->handle_);
+				}
+			}
+		}
+
+		[[nodiscard]]
+		static bool IsEarlier(const Timer* lhs, const Timer* rhs) noexcept
+		{
+			if (lhs->deadline_ != rhs->deadline_)
 			{
-				RemoteNode* current = head;
-				head = head->next;
-				handles_.emplace_back(current->handle);
-				delete current;
+				return lhs->deadline_ < rhs->deadline_;
 			}
+			return lhs->sequence_ < rhs->sequence_;
 		}
 
-		void PushRemote(std::coroutine_handle<> handle)
+		void PlaceTimer(std::size_t index, Timer* timer) noexcept
 		{
-			auto* node = new RemoteNode{nullptr, handle};
+			timers_[index] = timer;
+			timer->heapIndex_ = index;
+		}
 
-			RemoteNode* oldHead = remoteHead_.load(std::memory_order_relaxed);
-			do
+		void SiftUpTimer(std::size_t index) noexcept
+		{
+			Timer* timer = timers_[index];
+			while (index > 0)
 			{
-				node->next = oldHead;
-			} while (!remoteHead_.compare_exchange_weak(
-				oldHead, node,
-				std::memory_order_release,
-				std::memory_order_relaxed));
+				const std::size_t parent = (index - 1) / 2;
+				if (!IsEarlier(timer, timers_[parent]))
+				{
+					break;
+				}
+				PlaceTimer(index, timers_[parent]);
+				index = parent;
+			}
+			PlaceTimer(index, timer);
+		}
+
+		void SiftDownTimer(std::size_t index) noexcept
+		{
+			Timer* timer = timers_[index];
+			const std::size_t count = timers_.size();
+			while (true)
+			{
+				std::size_t child = index * 2 + 1;
+				if (child >= count)
+				{
+					break;
+				}
+				if (child + 1 < count && IsEarlier(timers_[child + 1], timers_[child]))
+				{
+					++child;
+				}
+				if (!IsEarlier(timers_[child], timer))
+				{
+					break;
+				}
+				PlaceTimer(index, timers_[child]);
+				index = child;
+			}
+			PlaceTimer(index, timer);
+		}
+
+		void RemoveTimerAt(std::size_t index) noexcept
+		{
+			pendingCount_.fetch_sub(1, std::memory_order_relaxed);
+			timers_[index]->heapIndex_ = Timer::InvalidIndex;
+
+			Timer* last = timers_.back();
+			timers_.pop_back();
+			if (index < timers_.size())
+			{
+				PlaceTimer(index, last);
+				SiftUpTimer(index);
+				SiftDownTimer(last->heapIndex_);
+			}
 		}
 
 		std::thread::id ownerId_;
-		std::vector<std::coroutine_handle<>> handles_;
-		std::vector<std::coroutine_handle<>> updateHandles_;
-		std::atomic<RemoteNode*> remoteHead_{nullptr};
+		TaskAllocator allocator_;
+		std::array<Lane, TaskPriorityCount> lanes_;
+		TaskPriority currentPriority_ = TaskPriority::Normal;
+		std::vector<Timer*> timers_;
+		std::uint64_t nextTimerSequence_ = 0;
+		// The queue keeps its positions on lines of their own, away from the owner-only state above.
+		RemoteQueue<RemoteEntry> remoteQueue_;
+		// Bumped by every thread that schedules here as well as by the owner.
+		alignas(Details::CacheLineSize) std::atomic<std::size_t> pendingCount_{0};
 	};
 }
 
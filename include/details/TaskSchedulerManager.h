@@ -1,10 +1,13 @@
 #ifndef TASKKIT_TASKSCHEDULER_MANAGER_H
 #define TASKKIT_TASKSCHEDULER_MANAGER_H
 #include <cassert>
+#include <chrono>
 #include <stack>
 #include <thread>
 #include <unordered_map>
 #include "Exceptions.h"
+#include "TaskAllocator.h"
+#include "TaskPriority.h"
 #include "TaskScheduler.h"
 #include "TaskSchedulerId.h"
 
@@ -19,13 +22,17 @@ namespace TKit
 		};
 
 	public:
-		TaskSchedulerManager() = default;
+		explicit TaskSchedulerManager(const TaskAllocator& allocator = TaskAllocator{}) :
+			allocator_(allocator)
+		{
+		}
+
 		~TaskSchedulerManager() = default;
 
 		TaskSchedulerId CreateScheduler(std::thread::id threadId, std::size_t reservedTaskCount)
 		{
 			auto& context = threadContexts_[threadId];
-			context.schedulers.emplace_back(reservedTaskCount, threadId);
+			context.schedulers.emplace_back(reservedTaskCount, threadId, allocator_);
 			return {threadId, context.schedulers.size() - 1};
 		}
 
@@ -38,6 +45,23 @@ namespace TKit
 			schedulers.at(id.GetInternalId()).Schedule(handle);
 		}
 
+		void Schedule(const TaskSchedulerId& id, std::coroutine_handle<> handle, TaskPriority priority)
+		{
+			GetScheduler(id).Schedule(handle, priority);
+		}
+
+		void ScheduleTimer(const TaskSchedulerId& id, TaskScheduler::Timer& timer)
+		{
+			assert(std::this_thread::get_id() == id.GetThreadId() && "TaskSchedulerManager: called from different thread");
+			GetScheduler(id).ScheduleTimer(timer);
+		}
+
+		void CancelTimer(const TaskSchedulerId& id, TaskScheduler::Timer& timer)
+		{
+			assert(std::this_thread::get_id() == id.GetThreadId() && "TaskSchedulerManager: called from different thread");
+			GetScheduler(id).CancelTimer(timer);
+		}
+
 		void ActivateScheduler(const TaskSchedulerId& id)
 		{
 			assert(std::this_thread::get_id() == id.GetThreadId() && "TaskSchedulerManager: called from different thread");
@@ -73,12 +97,23 @@ namespace TKit
 			GetScheduler(GetActivatedSchedulerId()).Update();
 		}
 
+		std::size_t UpdateActivatedSchedulerFor(std::chrono::nanoseconds budget)
+		{
+			return GetScheduler(GetActivatedSchedulerId()).UpdateFor(budget);
+		}
+
 		[[nodiscard]]
 		std::size_t GetPendingTaskCount(const TaskSchedulerId& id) const
 		{
 			return GetScheduler(id).GetPendingTaskCount();
 		}
 
+		[[nodiscard]]
+		const TaskAllocator& GetAllocator() const noexcept
+		{
+			return allocator_;
+		}
+
 		[[nodiscard]]
 		bool HasSchedulers(std::thread::id threadId) const
 		{
@@ -108,6 +143,7 @@ namespace TKit
 			return schedulers.at(id.GetInternalId());
 		}
 
+		TaskAllocator allocator_;
 		std::unordered_map<std::thread::id, ThreadContext> threadContexts_;
 	};
 }
@@ -2,16 +2,105 @@
 #define TASKKIT_TASK_SYSTEM_H
 
 #include <cassert>
+#include <chrono>
+#include <coroutine>
 #include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+#include "AwaitTransformer.h"
 #include "TaskSystemConfiguration.h"
 #include "PoolAllocator.h"
+#include "PoolMemoryResource.h"
 #include "TaskSchedulerId.h"
 #include "TaskSchedulerManager.h"
 #include "ThreadPool.h"
 #include "PromiseContext.h"
+#include "TaskAllocatorPolicy.h"
 
 namespace TKit
 {
+	namespace Details
+	{
+		// Kept trivially destructible for the same GCC 12 co_await issue as SleepRequest.
+		struct FrameBudgetRequest
+		{
+			PoolAllocator* allocator;
+		};
+
+		// Parks the awaiting coroutine on the allocator's budget waiters and reschedules it on its scheduler from
+		// whichever thread frees enough frames.
+		class FrameBudgetAwaiter final : PoolAllocator::BudgetWaiter
+		{
+		public:
+			explicit FrameBudgetAwaiter(const FrameBudgetRequest& request) :
+				allocator_(request.allocator)
+			{
+				wake = &Wake;
+			}
+
+			~FrameBudgetAwaiter()
+			{
+				if (isWaiting_)
+				{
+					allocator_->CancelBudgetWait(*this);
+				}
+			}
+
+			[[nodiscard]]
+			bool await_ready() const noexcept
+			{
+				return !allocator_ || !allocator_->IsOverBudget();
+			}
+
+			bool await_suspend(std::coroutine_handle<> handle)
+			{
+				schedulerId_ = PromiseContext::GetCurrent().GetSchedulerManager().GetActivatedSchedulerId();
+				handle_ = handle;
+				isWaiting_ = true;
+				if (allocator_->WaitForBudget(*this))
+				{
+					// Another thread may already be resuming the task, so this must not be touched any more.
+					return true;
+				}
+				isWaiting_ = false;
+				return false;
+			}
+
+			void await_resume() const noexcept
+			{
+			}
+
+			FrameBudgetAwaiter(const FrameBudgetAwaiter&) = delete;
+			FrameBudgetAwaiter& operator=(const FrameBudgetAwaiter&) = delete;
+			FrameBudgetAwaiter(FrameBudgetAwaiter&&) = delete;
+			FrameBudgetAwaiter& operator=(FrameBudgetAwaiter&&) = delete;
+
+		private:
+			// The awaiter may be gone as soon as the handle is scheduled.
+			static void Wake(PoolAllocator::BudgetWaiter* waiter)
+			{
+				auto* self = static_cast<FrameBudgetAwaiter*>(waiter);
+				self->isWaiting_ = false;
+				PromiseContext::GetCurrent().GetSchedulerManager().Schedule(self->schedulerId_, self->handle_);
+			}
+
+			PoolAllocator* allocator_;
+			TaskSchedulerId schedulerId_;
+			std::coroutine_handle<> handle_;
+			bool isWaiting_ = false;
+		};
+	}
+
+	template<>
+	class AwaitTransformer<Details::FrameBudgetRequest>
+	{
+	public:
+		static Details::FrameBudgetAwaiter Transform(const Details::FrameBudgetRequest& request)
+		{
+			return Details::FrameBudgetAwaiter{ request };
+		}
+	};
+
 	class TaskSystem final
 	{
 	public:
@@ -65,18 +154,34 @@ namespace TKit
 			assert(!IsInitialized() && "TaskSystem already initialized for this thread.");
 			auto& sharedState = GetSharedState();
 			sharedState.mainThreadId = std::this_thread::get_id();
-			sharedState.schedulerManager.emplace();
+
+			assert((std::is_same_v<TaskAllocatorPolicy, DynamicAllocatorPolicy> || !config.allocator.has_value()) &&
+				"TaskSystem: a custom allocator has no effect once TASKKIT_ALLOCATOR binds frames at compile time");
+			assert((!Details::PoolAllocatorBackedPolicy<TaskAllocatorPolicy> || config.poolAllocator == PoolAllocatorConfiguration{}) &&
+				"TaskSystem: configure the pool of a TASKKIT_ALLOCATOR policy in its GetPoolAllocator(), not WithPoolAllocator");
 
 			sharedState.useDefaultAllocator = !config.allocator.has_value();
 			if (sharedState.useDefaultAllocator)
 			{
-				auto* poolAllocator = new PoolAllocator();
+				// A compile-time pool outlives the TaskSystem and keeps its own configuration.
+				PoolAllocator* poolAllocator = Details::GetPolicyPoolAllocator<TaskAllocatorPolicy>();
+				if (!poolAllocator)
+				{
+					poolAllocator = new PoolAllocator(config.poolAllocator);
+				}
+
+				for (const auto& [frameSize, count] : config.prewarmedFrames)
+				{
+					poolAllocator->Reserve(frameSize, count);
+				}
 				sharedState.allocator = poolAllocator->CreateTaskAllocator();
+				sharedState.memoryResource.emplace(*poolAllocator);
 			}
 			else
 			{
 				sharedState.allocator = config.allocator.value();
 			}
+			sharedState.schedulerManager.emplace(sharedState.allocator);
 
 			const auto threadCount = config.threadPoolSize > 0
 				? config.threadPoolSize
@@ -84,7 +189,9 @@ namespace TKit
 			sharedState.threadPool = std::make_unique<ThreadPool>(
 				*sharedState.schedulerManager,
 				threadCount,
-				config.reservedTaskCount
+				config.reservedTaskCount,
+				config.workerSpinCount,
+				config.workerYieldCount
 			);
 
 			sharedState.promiseContext.emplace(sharedState.allocator, *sharedState.schedulerManager, *sharedState.threadPool);
@@ -104,8 +211,9 @@ namespace TKit
 
 			PromiseContext::SetCurrent(nullptr);
 			sharedState.promiseContext.reset();
+			sharedState.memoryResource.reset();
 
-			if (sharedState.useDefaultAllocator)
+			if (sharedState.useDefaultAllocator && !Details::GetPolicyPoolAllocator<TaskAllocatorPolicy>())
 			{
 				auto* poolAllocator = static_cast<PoolAllocator*>(GetAllocator().GetContext());
 				delete poolAllocator;
@@ -145,6 +253,14 @@ namespace TKit
 			GetSchedulerManager().UpdateActivatedScheduler();
 		}
 
+		// Resumes tasks until the budget is spent; the rest run first next time. Returns the number deferred.
+		static std::size_t UpdateActivatedSchedulerFor(std::chrono::nanoseconds budget)
+		{
+			assert(IsInitialized() && "TaskSystem not initialized for this thread. Call TaskSystem::Initialize() first.");
+
+			return GetSchedulerManager().UpdateActivatedSchedulerFor(budget);
+		}
+
 		static std::size_t GetPendingTaskCount(const TaskSchedulerId& id)
 		{
 			assert(IsInitialized() && "TaskSystem not initialized for this thread. Call TaskSystem::Initialize() first.");
@@ -159,6 +275,13 @@ namespace TKit
 			GetSchedulerManager().Schedule(id, handle);
 		}
 
+		static void Schedule(const TaskSchedulerId& id, std::coroutine_handle<> handle, TaskPriority priority)
+		{
+			assert(IsInitialized() && "TaskSystem not initialized for this thread. Call TaskSystem::Initialize() first.");
+
+			GetSchedulerManager().Schedule(id, handle, priority);
+		}
+
 		[[nodiscard]]
 		static TaskSchedulerId CreateScheduler(std::optional<std::thread::id> threadId = std::nullopt, std::size_t reservedTaskCount = 100)
 		{
@@ -168,6 +291,84 @@ namespace TKit
 			return GetSchedulerManager().CreateScheduler(threadId.value_or(std::this_thread::get_id()), reservedTaskCount);
 		}
 
+		// Returns the calling thread's fully free pool memory to the heap and reports the bytes released.
+		// Does nothing with a custom allocator.
+		static std::size_t TrimAllocator()
+		{
+			assert(IsInitialized() && "TaskSystem not initialized for this thread. Call TaskSystem::Initialize() first.");
+
+			if (!GetSharedState().useDefaultAllocator)
+			{
+				return 0;
+			}
+			return static_cast<PoolAllocator*>(GetAllocator().GetContext())->Trim();
+		}
+
+		// Snapshot of the default pool allocator's counters; empty with a custom allocator.
+		[[nodiscard]]
+		static PoolAllocator::Stats GetAllocatorStats()
+		{
+			assert(IsInitialized() && "TaskSystem not initialized for this thread. Call TaskSystem::Initialize() first.");
+
+			if (!GetSharedState().useDefaultAllocator)
+			{
+				return {};
+			}
+			return static_cast<PoolAllocator*>(GetAllocator().GetContext())->GetStats();
+		}
+
+		// Work-stealing counters of the shared thread pool, summed over its workers.
+		[[nodiscard]]
+		static ThreadPool::Stats GetThreadPoolStats()
+		{
+			assert(IsInitialized() && "TaskSystem not initialized for this thread. Call TaskSystem::Initialize() first.");
+			return GetSharedState().threadPool->GetStats();
+		}
+
+		// Frame sizes requested from the default pool allocator, when its configuration records them; feed the result
+		// to PoolAllocator::FitSizeClasses to tune the classes of later runs. Empty with a custom allocator.
+		[[nodiscard]]
+		static PoolAllocator::SizeHistogram GetAllocatorSizeHistogram()
+		{
+			assert(IsInitialized() && "TaskSystem not initialized for this thread. Call TaskSystem::Initialize() first.");
+
+			if (!GetSharedState().useDefaultAllocator)
+			{
+				return {};
+			}
+			return static_cast<PoolAllocator*>(GetAllocator().GetContext())->GetSizeHistogram();
+		}
+
+		// Backpressure for producers under MemoryBudgetPolicy::Gate: co_await it before spawning more tasks, and it
+		// holds the awaiting task until the default pool allocator's frame memory is within budget again. Completes at
+		// once without a budget or with a custom allocator.
+		[[nodiscard]]
+		static Details::FrameBudgetRequest WaitForFrameBudget()
+		{
+			assert(IsInitialized() && "TaskSystem not initialized for this thread. Call TaskSystem::Initialize() first.");
+
+			if (!GetSharedState().useDefaultAllocator)
+			{
+				return { nullptr };
+			}
+			return { static_cast<PoolAllocator*>(GetAllocator().GetContext()) };
+		}
+
+		// Lets task bodies build std::pmr containers from the same thread-local pools as the frames. Falls back to the
+		// global heap with a custom allocator. Valid until Shutdown.
+		[[nodiscard]]
+		static std::pmr::memory_resource* GetMemoryResource()
+		{
+			assert(IsInitialized() && "TaskSystem not initialized for this thread. Call TaskSystem::Initialize() first.");
+
+			auto& memoryResource = GetSharedState().memoryResource;
+			if (!memoryResource.has_value())
+			{
+				return std::pmr::new_delete_resource();
+			}
+			return &memoryResource.value();
+		}
+
 	private:
 		struct SharedState
 		{
@@ -176,6 +377,7 @@ namespace TKit
 			std::optional<TaskSchedulerManager> schedulerManager;
 			std::unique_ptr<ThreadPool> threadPool;
 			std::optional<PromiseContext> promiseContext;
+			std::optional<PoolMemoryResource> memoryResource;
 			bool useDefaultAllocator = true;
 			bool isInitialized = false;
 		};
@@ -1,7 +1,10 @@
 ﻿#ifndef TASKKIT_TASK_SYSTEM_CONFIGURATION_H
 #define TASKKIT_TASK_SYSTEM_CONFIGURATION_H
 
+#include <optional>
 #include <thread>
+#include <vector>
+#include "PoolAllocatorConfiguration.h"
 #include "TaskAllocator.h"
 
 namespace TKit
@@ -10,9 +13,19 @@ namespace TKit
 	{
 		class Builder;
 
+		struct PrewarmedFrames
+		{
+			std::size_t frameSize;
+			std::size_t count;
+		};
+
 		std::optional<TaskAllocator> allocator;
+		PoolAllocatorConfiguration poolAllocator;
+		std::vector<PrewarmedFrames> prewarmedFrames;
 		std::size_t threadPoolSize = 0;
 		std::size_t reservedTaskCount = 100;
+		std::size_t workerSpinCount = 64;
+		std::size_t workerYieldCount = 4;
 	};
 
 	class TaskSystemConfiguration::Builder
@@ -26,6 +39,22 @@ namespace TKit
 			return *this;
 		}
 
+		// Configures the default PoolAllocator; ignored with a custom allocator. Must be left alone when TASKKIT_ALLOCATOR
+		// names a policy with its own pool.
+		Builder& WithPoolAllocator(const PoolAllocatorConfiguration& configuration)
+		{
+			configuration_.poolAllocator = configuration;
+			return *this;
+		}
+
+		// Reserves pool blocks for count frames of frameSize bytes on the thread calling TaskSystem::Initialize, so spawning
+		// them later does not allocate slabs. May be called once per frame size; ignored with a custom allocator.
+		Builder& WithPrewarmedFrames(std::size_t frameSize, std::size_t count)
+		{
+			configuration_.prewarmedFrames.push_back({ frameSize, count });
+			return *this;
+		}
+
 		Builder& WithThreadPoolSize(std::size_t size)
 		{
 			configuration_.threadPoolSize = size;
@@ -38,6 +67,19 @@ namespace TKit
 			return *this;
 		}
 
+		// Idle workers re-check for work this many times before yielding, then yield this many times before parking.
+		Builder& WithWorkerSpinCount(std::size_t count)
+		{
+			configuration_.workerSpinCount = count;
+			return *this;
+		}
+
+		Builder& WithWorkerYieldCount(std::size_t count)
+		{
+			configuration_.workerYieldCount = count;
+			return *this;
+		}
+
 		[[nodiscard]]
 		TaskSystemConfiguration Build() const
 		{
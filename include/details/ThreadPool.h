@@ -4,32 +4,65 @@
 #include <cassert>
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
+#include "CacheLine.h"
+#include "RemoteQueue.h"
 #include "TaskScheduler.h"
 #include "TaskSchedulerId.h"
 #include "TaskSchedulerManager.h"
+#include "WorkStealingDeque.h"
 
 namespace TKit
 {
 	class ThreadPool final
 	{
-		struct WorkerContext
+		// Contexts are allocated one by one and never share a line with a neighbour's.
+		struct alignas(Details::CacheLineSize) WorkerContext
 		{
+			explicit WorkerContext(std::size_t reservedTaskCount) :
+				deque(reservedTaskCount),
+				inbox(reservedTaskCount)
+			{
+			}
+
 			TaskSchedulerId schedulerId;
-			std::mutex mutex;
-			std::condition_variable cv;
+			WorkStealingDeque deque;
+			RemoteQueue<std::coroutine_handle<>> inbox;
+			std::atomic<std::size_t> stealCount{0};
+			std::atomic<std::size_t> failedStealCount{0};
+			std::size_t nextSibling = 0;
+			// Read by every thread that wakes this worker, so kept away from the counters the worker bumps.
+			alignas(Details::CacheLineSize) std::atomic<std::uint32_t> wakeEpoch{0};
+			std::atomic<bool> sleeping{false};
+		};
+
+		struct CurrentWorker
+		{
+			const ThreadPool* pool = nullptr;
+			std::size_t index = 0;
 		};
 
 	public:
+		struct Stats
+		{
+			std::size_t stealCount = 0;
+			std::size_t failedStealCount = 0;
+		};
+
 		ThreadPool(
 			TaskSchedulerManager& schedulerManager,
 			std::size_t threadCount,
-			std::size_t reservedTaskCount = 100
+			std::size_t reservedTaskCount = 100,
+			std::size_t spinCount = 64,
+			std::size_t yieldCount = 4
 		) :
 			schedulerManager_(&schedulerManager),
+			spinCount_(spinCount),
+			yieldCount_(yieldCount),
 			running_(true)
 		{
 			workers_.reserve(threadCount);
@@ -37,7 +70,7 @@ namespace TKit
 
 			for (std::size_t i = 0; i < threadCount; ++i)
 			{
-				workerContexts_.push_back(std::make_unique<WorkerContext>());
+				workerContexts_.push_back(std::make_unique<WorkerContext>(reservedTaskCount));
 			}
 
 			std::atomic<std::size_t> waitingWorkers{0};
@@ -92,8 +125,8 @@ namespace TKit
 
 			for (auto& context : workerContexts_)
 			{
-				std::lock_guard lock(context->mutex);
-				context->cv.notify_one();
+				context->wakeEpoch.fetch_add(1, std::memory_order_release);
+				context->wakeEpoch.notify_one();
 			}
 
 			for (auto& worker : workers_)
@@ -103,24 +136,39 @@ namespace TKit
 					worker.join();
 				}
 			}
+
+			for (auto& context : workerContexts_)
+			{
+				context->inbox.Drain([](std::coroutine_handle<> handle) { handle.destroy(); });
+			}
 		}
 
+		// Work scheduled from a worker stays on that worker's deque; other submissions are spread round-robin. Either
+		// way, a parked worker is woken to steal it when its owner is busy, and spinning workers find it on their own.
 		void Schedule(std::coroutine_handle<> handle)
 		{
-			const std::size_t index = nextScheduler_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
-			schedulerManager_->Schedule(workerContexts_[index]->schedulerId, handle);
+			const CurrentWorker& current = GetCurrentWorker();
+			if (current.pool == this)
+			{
+				workerContexts_[current.index]->deque.Push(handle);
+				WakeSibling(current.index);
+				return;
+			}
 
-			std::lock_guard lock(workerContexts_[index]->mutex);
-			workerContexts_[index]->cv.notify_one();
+			const std::size_t index = nextScheduler_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+			workerContexts_[index]->inbox.Push(handle);
+			if (!Wake(index))
+			{
+				WakeParkedWorker(index);
+			}
 		}
 
+		// Pinned work: it always runs on the given worker and is never stolen.
 		void Schedule(std::size_t workerIndex, std::coroutine_handle<> handle)
 		{
 			assert(workerIndex < workers_.size() && "ThreadPool: invalid worker index");
 			schedulerManager_->Schedule(workerContexts_[workerIndex]->schedulerId, handle);
-
-			std::lock_guard lock(workerContexts_[workerIndex]->mutex);
-			workerContexts_[workerIndex]->cv.notify_one();
+			Wake(workerIndex);
 		}
 
 		[[nodiscard]]
@@ -136,45 +184,230 @@ namespace TKit
 			return workerContexts_[workerIndex]->schedulerId;
 		}
 
+		[[nodiscard]]
+		Stats GetStats() const
+		{
+			Stats stats;
+			for (const auto& context : workerContexts_)
+			{
+				stats.stealCount += context->stealCount.load(std::memory_order_relaxed);
+				stats.failedStealCount += context->failedStealCount.load(std::memory_order_relaxed);
+			}
+			return stats;
+		}
+
 		ThreadPool(const ThreadPool&) = delete;
 		ThreadPool& operator=(const ThreadPool&) = delete;
 		ThreadPool(ThreadPool&&) = delete;
 		ThreadPool& operator=(ThreadPool&&) = delete;
 
 	private:
-		void WorkerMain(std::size_t workerIndex)
+		[[nodiscard]]
+		static CurrentWorker& GetCurrentWorker() noexcept
+		{
+			thread_local CurrentWorker current;
+			return current;
+		}
+
+		// Moves the inbox entries of source into the calling worker's deque in submission order.
+		// Any thread may drain an inbox, which is how work queued behind a busy worker gets stolen.
+		static std::size_t TakeInbox(WorkerContext& source, WorkerContext& destination)
+		{
+			return source.inbox.Drain([&destination](std::coroutine_handle<> handle) { destination.deque.Push(handle); });
+		}
+
+		// Pairs with the fence in Park: either the worker sees the new work before sleeping, or this sees it sleeping.
+		// A busy or spinning worker costs the producer one fence and one load. Returns whether the worker was asleep.
+		bool Wake(std::size_t workerIndex)
 		{
 			auto& context = *workerContexts_[workerIndex];
-			auto schedulerId = context.schedulerId;
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (context.sleeping.load(std::memory_order_relaxed))
+			{
+				context.wakeEpoch.fetch_add(1, std::memory_order_release);
+				context.wakeEpoch.notify_one();
+				return true;
+			}
+			return false;
+		}
 
-			while (true)
+		// For an inbox whose owner is awake and may be stuck in a long job: the first parked worker after it is woken
+		// and takes the inbox through TrySteal. Called right after Wake, whose fence also orders these loads.
+		void WakeParkedWorker(std::size_t busyIndex)
+		{
+			for (std::size_t offset = 1; offset < workers_.size(); ++offset)
 			{
+				const std::size_t index = (busyIndex + offset) % workers_.size();
+				if (workerContexts_[index]->sleeping.load(std::memory_order_relaxed))
 				{
-					std::unique_lock lock(context.mutex);
-					context.cv.wait(lock, [this, &schedulerId]()
-					{
-						return !running_.load(std::memory_order_acquire) ||
-						       schedulerManager_->GetPendingTaskCount(schedulerId) > 0;
-					});
+					Wake(index);
+					return;
+				}
+			}
+		}
+
+		// Only called by the worker itself, so its sibling cursor needs no synchronization.
+		void WakeSibling(std::size_t workerIndex)
+		{
+			if (workers_.size() > 1)
+			{
+				auto& context = *workerContexts_[workerIndex];
+				const std::size_t offset = 1 + context.nextSibling++ % (workers_.size() - 1);
+				Wake((workerIndex + offset) % workers_.size());
+			}
+		}
+
+		[[nodiscard]]
+		static bool HasStealableWork(const WorkerContext& context) noexcept
+		{
+			return context.deque.GetApproximateSize() > 0 ||
+			       !context.inbox.IsEmpty();
+		}
 
-					if (!running_.load(std::memory_order_acquire) &&
-					    schedulerManager_->GetPendingTaskCount(schedulerId) == 0)
+		[[nodiscard]]
+		bool HasWork(std::size_t workerIndex) const
+		{
+			if (schedulerManager_->GetPendingTaskCount(workerContexts_[workerIndex]->schedulerId) > 0)
+			{
+				return true;
+			}
+
+			for (const auto& context : workerContexts_)
+			{
+				if (HasStealableWork(*context))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		std::coroutine_handle<> TrySteal(std::size_t thiefIndex)
+		{
+			auto& thief = *workerContexts_[thiefIndex];
+			const std::size_t workerCount = workerContexts_.size();
+
+			for (std::size_t offset = 1; offset < workerCount; ++offset)
+			{
+				auto& victim = *workerContexts_[(thiefIndex + offset) % workerCount];
+				if (!HasStealableWork(victim))
+				{
+					continue;
+				}
+
+				if (auto handle = victim.deque.Steal())
+				{
+					thief.stealCount.fetch_add(1, std::memory_order_relaxed);
+					return handle;
+				}
+
+				if (const std::size_t count = TakeInbox(victim, thief); count > 0)
+				{
+					thief.stealCount.fetch_add(1, std::memory_order_relaxed);
+					if (count > 1)
 					{
-						break;
+						WakeSibling(thiefIndex);
 					}
+					return thief.deque.Pop();
 				}
 
-				schedulerManager_->ActivateScheduler(schedulerId);
-				schedulerManager_->UpdateActivatedScheduler();
-				schedulerManager_->DeactivateScheduler();
+				thief.failedStealCount.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			return nullptr;
+		}
+
+		void RunAvailableWork(std::size_t workerIndex)
+		{
+			auto& context = *workerContexts_[workerIndex];
+
+			schedulerManager_->UpdateActivatedScheduler();
+
+			if (TakeInbox(context, context) > 1)
+			{
+				WakeSibling(workerIndex);
 			}
+
+			while (auto handle = context.deque.Pop())
+			{
+				handle.resume();
+			}
+
+			if (auto handle = TrySteal(workerIndex))
+			{
+				handle.resume();
+			}
+		}
+
+		// Eventcount: read the epoch, announce sleep, then re-check for work before waiting on the epoch.
+		void Park(std::size_t workerIndex)
+		{
+			auto& context = *workerContexts_[workerIndex];
+			// Frames freed since the last update would otherwise stay batched on this worker while it sleeps.
+			schedulerManager_->GetAllocator().Flush();
+			const std::uint32_t epoch = context.wakeEpoch.load(std::memory_order_acquire);
+
+			context.sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			if (running_.load(std::memory_order_acquire) && !HasWork(workerIndex))
+			{
+				context.wakeEpoch.wait(epoch, std::memory_order_acquire);
+			}
+
+			context.sleeping.store(false, std::memory_order_relaxed);
+		}
+
+		void WorkerMain(std::size_t workerIndex)
+		{
+			auto& context = *workerContexts_[workerIndex];
+			GetCurrentWorker() = CurrentWorker{ this, workerIndex };
+			schedulerManager_->ActivateScheduler(context.schedulerId);
+
+			std::size_t idleRounds = 0;
+			while (true)
+			{
+				if (HasWork(workerIndex))
+				{
+					RunAvailableWork(workerIndex);
+					idleRounds = 0;
+					continue;
+				}
+
+				if (!running_.load(std::memory_order_acquire))
+				{
+					break;
+				}
+
+				if (idleRounds < spinCount_)
+				{
+					++idleRounds;
+				}
+				else if (idleRounds < spinCount_ + yieldCount_)
+				{
+					++idleRounds;
+					std::this_thread::yield();
+				}
+				else
+				{
+					Park(workerIndex);
+					idleRounds = 0;
+				}
+			}
+
+			schedulerManager_->DeactivateScheduler();
+			GetCurrentWorker() = CurrentWorker{};
 		}
 
 		TaskSchedulerManager* schedulerManager_;
 		std::vector<std::thread> workers_;
 		std::vector<std::unique_ptr<WorkerContext>> workerContexts_;
-		std::atomic<std::size_t> nextScheduler_{0};
+		std::size_t spinCount_;
+		std::size_t yieldCount_;
+		// Polled by every idle worker, so it stays with the fields that never change after construction.
 		std::atomic<bool> running_;
+		// Bumped by every submission from outside the pool.
+		alignas(Details::CacheLineSize) std::atomic<std::size_t> nextScheduler_{0};
 	};
 }
 
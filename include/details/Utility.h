@@ -1,11 +1,20 @@
 ﻿#ifndef TASKKIT_UTILITY_H
 #define TASKKIT_UTILITY_H
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
 #include <functional>
-#include <memory>
 #include <optional>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
 #include <tuple>
+#include <utility>
+#include <vector>
 #include "Task.h"
+#include "TaskPriority.h"
 #include "TaskSchedulerId.h"
 #include "ThreadPool.h"
 
@@ -40,49 +49,129 @@ namespace TKit
 
 		template<typename... Results>
 		constexpr bool HasAnyType = (sizeof...(Results) > 0);
+	}
 
-		template<typename Result>
-		inline auto ToMonostateIfVoid(Task<Result>&& task)
+	inline void ThrowIfStopRequested(const std::stop_token& stopToken)
+	{
+		if (stopToken.stop_requested())
 		{
-			if constexpr (std::is_void_v<Result>)
+			throw OperationStoppedError();
+		}
+	}
+
+	namespace Details
+	{
+		// Kept trivially destructible: GCC 12 may destroy non-trivial temporaries of a co_await operand twice.
+		struct SleepRequest
+		{
+			TaskScheduler::Clock::time_point deadline;
+			const std::stop_token* stopToken;
+		};
+
+		// Parks the awaiting coroutine in the activated scheduler's timer heap instead of re-queuing it every frame.
+		// A stop request wakes it early on its scheduler; whichever side claims the timer first resumes it.
+		class SleepAwaiter final
+		{
+			struct StopHandler
+			{
+				SleepAwaiter* awaiter;
+
+				void operator()() const noexcept
+				{
+					awaiter->WakeOnStop();
+				}
+			};
+
+		public:
+			explicit SleepAwaiter(const SleepRequest& request) :
+				deadline_(request.deadline),
+				stopToken_(*request.stopToken)
 			{
-				return std::move(task).ToMonostateTask();
 			}
-			else
+
+			~SleepAwaiter()
 			{
-				return std::move(task);
+				CancelTimer();
 			}
-		}
 
-		template<std::size_t I, typename ResultVariant, typename TaskResult>
-		inline Task<> WhenAnyHelperTask(std::shared_ptr<std::optional<ResultVariant>> result, Task<TaskResult> task)
-		{
-			auto taskResult = co_await std::move(task);
-			if (!result->has_value())
+			[[nodiscard]]
+			bool await_ready() const noexcept
 			{
-				*result = ResultVariant(std::in_place_index<I>, std::move(taskResult));
+				return stopToken_.stop_requested() || deadline_ <= TaskScheduler::Clock::now();
 			}
-		}
 
-		template<std::size_t I, typename ResultVariant, typename First, typename... Others>
-		inline void WhenAnyHelper(std::shared_ptr<std::optional<ResultVariant>> result, Task<First>&& first, Task<Others>&&... others)
-		{
-			WhenAnyHelperTask<I>(result, std::move(first)).Forget();
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				auto& schedulerManager = PromiseContext::GetCurrent().GetSchedulerManager();
+				schedulerId_ = schedulerManager.GetActivatedSchedulerId();
+				timer_.emplace(deadline_, handle);
+				schedulerManager.ScheduleTimer(schedulerId_, *timer_);
+
+				if (stopToken_.stop_possible())
+				{
+					stopCallback_.emplace(stopToken_, StopHandler{ this });
+				}
+			}
+
+			void await_resume()
+			{
+				CancelTimer();
+			}
+
+			SleepAwaiter(const SleepAwaiter&) = delete;
+			SleepAwaiter& operator=(const SleepAwaiter&) = delete;
+			SleepAwaiter(SleepAwaiter&&) = delete;
+			SleepAwaiter& operator=(SleepAwaiter&&) = delete;
 
-			if constexpr (sizeof...(others) > 0)
+		private:
+			void WakeOnStop() noexcept
+			{
+				if (timer_->TryClaim())
+				{
+					PromiseContext::GetCurrent().GetSchedulerManager().Schedule(schedulerId_, timer_->GetHandle(), timer_->GetPriority());
+				}
+			}
+
+			void CancelTimer()
+			{
+				if (timer_ && timer_->IsScheduled())
+				{
+					PromiseContext::GetCurrent().GetSchedulerManager().CancelTimer(schedulerId_, *timer_);
+				}
+			}
+
+			TaskScheduler::Clock::time_point deadline_;
+			std::stop_token stopToken_;
+			TaskSchedulerId schedulerId_;
+			std::optional<TaskScheduler::Timer> timer_;
+			std::optional<std::stop_callback<StopHandler>> stopCallback_;
+		};
+
+		template<typename Clock, typename Duration>
+		[[nodiscard]]
+		inline TaskScheduler::Clock::time_point ToSchedulerTimePoint(std::chrono::time_point<Clock, Duration> timePoint)
+		{
+			using SchedulerClock = TaskScheduler::Clock;
+			if constexpr (std::is_same_v<Clock, SchedulerClock>)
 			{
-				WhenAnyHelper<I + 1>(result, std::move(others)...);
+				return std::chrono::ceil<SchedulerClock::duration>(timePoint);
+			}
+			else
+			{
+				return SchedulerClock::now() + std::chrono::ceil<SchedulerClock::duration>(timePoint - Clock::now());
 			}
 		}
 	}
 
-	inline void ThrowIfStopRequested(const std::stop_token& stopToken)
+	template<>
+	class AwaitTransformer<Details::SleepRequest>
 	{
-		if (stopToken.stop_requested())
+	public:
+		static Details::SleepAwaiter Transform(const Details::SleepRequest& request)
 		{
-			throw OperationStoppedError();
+			return Details::SleepAwaiter{ request };
 		}
-	}
+	};
 
 	struct SwitchToThreadPoolAwaiter
 	{
@@ -152,6 +241,43 @@ namespace TKit
 		}
 	};
 
+	struct SwitchToPriorityAwaiter
+	{
+		TaskPriority priority;
+
+		[[nodiscard]]
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) const
+		{
+			auto& schedulerManager = PromiseContext::GetCurrent().GetSchedulerManager();
+			schedulerManager.Schedule(schedulerManager.GetActivatedSchedulerId(), handle, priority);
+		}
+
+		void await_resume() const noexcept
+		{
+		}
+	};
+
+	// Requeues the task in the given lane of the activated scheduler; later frames and timers inherit that lane.
+	inline SwitchToPriorityAwaiter SwitchToPriority(TaskPriority priority)
+	{
+		return SwitchToPriorityAwaiter{priority};
+	}
+
+	template<>
+	class AwaitTransformer<SwitchToPriorityAwaiter>
+	{
+	public:
+		static SwitchToPriorityAwaiter Transform(SwitchToPriorityAwaiter awaiter) noexcept
+		{
+			return awaiter;
+		}
+	};
+
 	template<typename Func>
 		requires std::is_invocable_v<Func> && (!Details::TaskFuncTraits<Func>::IsTask)
 	inline Task<std::invoke_result_t<Func>> RunOnThreadPool(Func&& func)
@@ -229,12 +355,12 @@ namespace TKit
 	template<typename Rep, typename Period>
 	inline Task<> WaitFor(std::chrono::duration<Rep, Period> duration, std::stop_token stopToken = {})
 	{
-		const auto start = std::chrono::steady_clock::now();
-		while (std::chrono::steady_clock::now() - start < duration)
-		{
-			ThrowIfStopRequested(stopToken);
-			co_yield {};
-		}
+		ThrowIfStopRequested(stopToken);
+
+		co_await Details::SleepRequest{
+			TaskScheduler::Clock::now() + std::chrono::ceil<TaskScheduler::Clock::duration>(duration),
+			&stopToken
+		};
 
 		ThrowIfStopRequested(stopToken);
 		co_return;
@@ -243,11 +369,9 @@ namespace TKit
 	template<typename Clock, typename Duration>
 	inline Task<> WaitUntil(std::chrono::time_point<Clock, Duration> timePoint, std::stop_token stopToken = {})
 	{
-		while (Clock::now() < timePoint)
-		{
-			ThrowIfStopRequested(stopToken);
-			co_yield {};
-		}
+		ThrowIfStopRequested(stopToken);
+
+		co_await Details::SleepRequest{ Details::ToSchedulerTimePoint(timePoint), &stopToken };
 
 		ThrowIfStopRequested(stopToken);
 		co_return;
@@ -256,67 +380,646 @@ namespace TKit
 	template<typename... Results>
 	using WhenAllResultType = std::tuple<std::conditional_t<std::is_void_v<Results>, std::monostate, Results>...>;
 
+	namespace Details
+	{
+		// Counts down once per task and once for the awaiting coroutine, so that coroutine is resumed exactly once,
+		// on whichever thread arrives last. Lives in the awaiting coroutine's frame, which outlives every task it watches.
+		class CompletionLatch final
+		{
+		public:
+			explicit CompletionLatch(std::size_t taskCount) noexcept :
+				remaining_(taskCount + 1)
+			{
+			}
+
+			template<typename Result>
+			void Watch(Task<Result>& task) noexcept
+			{
+				if (!task.OnCompleted(&OnTaskCompleted, this))
+				{
+					// The awaiting coroutine has not arrived yet, so this can never be the last arrival.
+					remaining_.fetch_sub(1, std::memory_order_acq_rel);
+				}
+			}
+
+			// Returns false when every task has already completed and the awaiting coroutine should not suspend.
+			bool Wait(std::coroutine_handle<> handle) noexcept
+			{
+				waiter_ = handle;
+				return !Arrive();
+			}
+
+			CompletionLatch(const CompletionLatch&) = delete;
+			CompletionLatch& operator=(const CompletionLatch&) = delete;
+			CompletionLatch(CompletionLatch&&) = delete;
+			CompletionLatch& operator=(CompletionLatch&&) = delete;
+
+		private:
+			bool Arrive() noexcept
+			{
+				return remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+			}
+
+			static std::coroutine_handle<> OnTaskCompleted(void* context) noexcept
+			{
+				auto* latch = static_cast<CompletionLatch*>(context);
+				return latch->Arrive() ? latch->waiter_ : std::noop_coroutine();
+			}
+
+			std::atomic<std::size_t> remaining_;
+			std::coroutine_handle<> waiter_;
+		};
+
+		template<typename Result>
+		inline auto GetResultOrMonostate(Task<Result>& task)
+		{
+			if constexpr (std::is_void_v<Result>)
+			{
+				task.GetResult();
+				return std::monostate{};
+			}
+			else
+			{
+				return task.GetResult();
+			}
+		}
+
+		// Kept trivially destructible for the same GCC 12 co_await issue as SleepRequest; the tasks live in the caller's frame.
+		template<typename... Results>
+		struct WhenAllRequest
+		{
+			std::tuple<Task<Results>...>* tasks;
+		};
+
+		template<typename Result>
+		struct WhenAllRangeRequest
+		{
+			std::vector<Task<Result>>* tasks;
+		};
+
+		template<typename... Results>
+		class WhenAllAwaiter final
+		{
+		public:
+			explicit WhenAllAwaiter(std::tuple<Task<Results>...>* tasks) noexcept :
+				tasks_(tasks),
+				latch_(sizeof...(Results))
+			{
+			}
+
+			[[nodiscard]]
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			bool await_suspend(std::coroutine_handle<> handle) noexcept
+			{
+				std::apply([this](auto&... tasks) { (latch_.Watch(tasks), ...); }, *tasks_);
+				return latch_.Wait(handle);
+			}
+
+			// Rethrows the first failure in argument order.
+			WhenAllResultType<Results...> await_resume()
+			{
+				return std::apply([](auto&... tasks) { return WhenAllResultType<Results...>{ GetResultOrMonostate(tasks)... }; }, *tasks_);
+			}
+
+		private:
+			std::tuple<Task<Results>...>* tasks_;
+			CompletionLatch latch_;
+		};
+
+		template<typename Result>
+		class WhenAllRangeAwaiter final
+		{
+		public:
+			using ResultType = std::conditional_t<std::is_void_v<Result>, void, std::vector<Result>>;
+
+			explicit WhenAllRangeAwaiter(std::vector<Task<Result>>* tasks) noexcept :
+				tasks_(tasks),
+				latch_(tasks->size())
+			{
+			}
+
+			[[nodiscard]]
+			bool await_ready() const noexcept
+			{
+				return tasks_->empty();
+			}
+
+			bool await_suspend(std::coroutine_handle<> handle) noexcept
+			{
+				for (auto& task : *tasks_)
+				{
+					latch_.Watch(task);
+				}
+				return latch_.Wait(handle);
+			}
+
+			// Rethrows the first failure in vector order. Results are written into one allocation sized up front.
+			ResultType await_resume()
+			{
+				if constexpr (std::is_void_v<Result>)
+				{
+					for (auto& task : *tasks_)
+					{
+						task.GetResult();
+					}
+				}
+				else
+				{
+					std::vector<Result> results;
+					results.reserve(tasks_->size());
+					for (auto& task : *tasks_)
+					{
+						results.push_back(task.GetResult());
+					}
+					return results;
+				}
+			}
+
+		private:
+			std::vector<Task<Result>>* tasks_;
+			CompletionLatch latch_;
+		};
+	}
+
+	template<typename... Results>
+	class AwaitTransformer<Details::WhenAllRequest<Results...>>
+	{
+	public:
+		static Details::WhenAllAwaiter<Results...> Transform(const Details::WhenAllRequest<Results...>& request) noexcept
+		{
+			return Details::WhenAllAwaiter<Results...>{ request.tasks };
+		}
+	};
+
+	template<typename Result>
+	class AwaitTransformer<Details::WhenAllRangeRequest<Result>>
+	{
+	public:
+		static Details::WhenAllRangeAwaiter<Result> Transform(const Details::WhenAllRangeRequest<Result>& request) noexcept
+		{
+			return Details::WhenAllRangeAwaiter<Result>{ request.tasks };
+		}
+	};
+
+	// All tasks run concurrently and the awaiting coroutine is resumed once, by the last one to finish.
 	template<typename... Results>
 		requires Details::HasAnyType<Results...> && (!Details::FulfillsAllVoid<void, Results...>)
 	inline Task<WhenAllResultType<Results...>> WhenAll(Task<Results>&&... tasks)
 	{
-		co_return std::make_tuple(co_await Details::ToMonostateIfVoid(std::move(tasks))...);
+		std::tuple<Task<Results>...> children(std::move(tasks)...);
+		co_return co_await Details::WhenAllRequest<Results...>{ &children };
 	}
 
 	template<typename... Results>
 		requires Details::HasAnyType<Results...> && Details::FulfillsAllVoid<Results...>
 	inline Task<> WhenAll(Task<Results>&&... tasks)
 	{
-		(co_await std::move(tasks), ...);
+		std::tuple<Task<Results>...> children(std::move(tasks)...);
+		co_await Details::WhenAllRequest<Results...>{ &children };
 		co_return;
 	}
 
 	inline Task<> WhenAll(std::vector<Task<>> tasks)
 	{
-		if (tasks.empty())
-		{
-			co_return;
-		}
-
-		for (auto& task : tasks)
-		{
-			co_await std::move(task);
-		}
-
+		co_await Details::WhenAllRangeRequest<void>{ &tasks };
 		co_return;
 	}
 
+	// Results come back in the order of the tasks, not the order they finished in.
+	template<typename Result>
+		requires (!std::is_void_v<Result>)
+	inline Task<std::vector<Result>> WhenAll(std::vector<Task<Result>> tasks)
+	{
+		co_return co_await Details::WhenAllRangeRequest<Result>{ &tasks };
+	}
+
 	template<typename... Results>
 	using WhenAnyResultType = std::variant<std::conditional_t<std::is_void_v<Results>, std::monostate, Results>...>;
 
-	template<typename... Results>
-		requires Details::HasAnyType<Results...> && (!Details::FulfillsAllVoid<Results...>)
-	inline Task<WhenAnyResultType<Results...>> WhenAny(Task<Results>&&... tasks)
+	template<typename Result>
+	using WhenAnyRangeResultType = std::conditional_t<std::is_void_v<Result>, std::size_t, std::pair<std::size_t, Result>>;
+
+	namespace Details
 	{
-		auto result = std::make_shared<std::optional<WhenAnyResultType<Results...>>>();
-		Details::WhenAnyHelper<0>(result, Details::ToMonostateIfVoid(std::move(tasks))...);
+		// Shared by WhenAny and the tasks it watches, allocated once from the TaskAllocator.
+		// Each task holds a reference until it completes and the awaiting coroutine holds one until it resumes, so the
+		// losing tasks keep running after the winner has been delivered and the last one to finish frees the block.
+		class WhenAnyControl
+		{
+		public:
+			[[nodiscard]]
+			bool IsCompleted() const noexcept
+			{
+				return waiter_.load(std::memory_order_acquire) == GetCompletedMarker();
+			}
+
+			// Returns false without waiting when the winner has already been delivered.
+			bool TryWait(std::coroutine_handle<> handle) noexcept
+			{
+				void* expected = nullptr;
+				return waiter_.compare_exchange_strong(expected, handle.address(), std::memory_order_acq_rel, std::memory_order_acquire);
+			}
+
+			// Called when the awaiting coroutine is destroyed while still suspended, so the winner does not resume it.
+			void StopWaiting() noexcept
+			{
+				void* current = waiter_.load(std::memory_order_acquire);
+				if (current != GetCompletedMarker())
+				{
+					waiter_.compare_exchange_strong(current, nullptr, std::memory_order_acq_rel, std::memory_order_acquire);
+				}
+			}
+
+			WhenAnyControl(const WhenAnyControl&) = delete;
+			WhenAnyControl& operator=(const WhenAnyControl&) = delete;
+			WhenAnyControl(WhenAnyControl&&) = delete;
+			WhenAnyControl& operator=(WhenAnyControl&&) = delete;
+
+		protected:
+			explicit WhenAnyControl(std::size_t taskCount) noexcept :
+				refCount_(taskCount + 1)
+			{
+			}
+
+			~WhenAnyControl() = default;
+
+			// Only the first completed task gets to store its result.
+			bool TryClaim() noexcept
+			{
+				return !claimed_.exchange(true, std::memory_order_acq_rel);
+			}
+
+			// Called by the winner after storing its result; returns the coroutine to resume, if it is already waiting.
+			std::coroutine_handle<> Publish() noexcept
+			{
+				if (void* waiter = waiter_.exchange(GetCompletedMarker(), std::memory_order_acq_rel))
+				{
+					return std::coroutine_handle<>::from_address(waiter);
+				}
+				return std::noop_coroutine();
+			}
+
+			// Returns true for the last reference, which must destroy the block.
+			bool DropReference() noexcept
+			{
+				return refCount_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+			}
+
+			void RethrowIfFailed() const
+			{
+				if (exception_)
+				{
+					std::rethrow_exception(exception_);
+				}
+			}
+
+			std::exception_ptr exception_;
+
+		private:
+			[[nodiscard]]
+			void* GetCompletedMarker() const noexcept
+			{
+				return const_cast<WhenAnyControl*>(this);
+			}
+
+			std::atomic<void*> waiter_{nullptr};
+			std::atomic<std::size_t> refCount_;
+			std::atomic<bool> claimed_{false};
+		};
+
+		template<typename... Results>
+		class WhenAnyState final : public WhenAnyControl
+		{
+		public:
+			using ResultType = WhenAnyResultType<Results...>;
+
+			[[nodiscard]]
+			static WhenAnyState* Create(Task<Results>&&... tasks)
+			{
+				void* memory = TaskAllocatorPolicy::Allocate(sizeof(WhenAnyState));
+				return new (memory) WhenAnyState(std::move(tasks)...);
+			}
+
+			// Tasks that have already completed are handled right away.
+			void Start() noexcept
+			{
+				Start(std::index_sequence_for<Results...>{});
+			}
+
+			ResultType TakeResult()
+			{
+				RethrowIfFailed();
+				return std::move(*result_);
+			}
+
+			void Release() noexcept
+			{
+				if (DropReference())
+				{
+					this->~WhenAnyState();
+					TaskAllocatorPolicy::Deallocate(this, sizeof(WhenAnyState));
+				}
+			}
+
+		private:
+			explicit WhenAnyState(Task<Results>&&... tasks) :
+				WhenAnyControl(sizeof...(Results)),
+				tasks_(std::move(tasks)...)
+			{
+			}
+
+			~WhenAnyState() = default;
+
+			template<std::size_t... Indices>
+			void Start(std::index_sequence<Indices...>) noexcept
+			{
+				(StartAt<Indices>(), ...);
+			}
+
+			template<std::size_t I>
+			void StartAt() noexcept
+			{
+				if (!std::get<I>(tasks_).OnCompleted(&OnTaskCompleted<I>, this))
+				{
+					// Nothing is waiting yet, so there is no continuation to resume.
+					static_cast<void>(OnTaskCompleted<I>(this));
+				}
+			}
+
+			template<std::size_t I>
+			static std::coroutine_handle<> OnTaskCompleted(void* context) noexcept
+			{
+				auto* state = static_cast<WhenAnyState*>(context);
+				std::coroutine_handle<> next = std::noop_coroutine();
 
-		while (!result->has_value())
+				if (state->TryClaim())
+				{
+					state->template StoreResult<I>();
+					next = state->Publish();
+				}
+
+				state->Release();
+				return next;
+			}
+
+			template<std::size_t I>
+			void StoreResult() noexcept
+			{
+				try
+				{
+					auto& task = std::get<I>(tasks_);
+					if constexpr (std::is_void_v<std::tuple_element_t<I, std::tuple<Results...>>>)
+					{
+						task.GetResult();
+						result_.emplace(std::in_place_index<I>);
+					}
+					else
+					{
+						result_.emplace(std::in_place_index<I>, task.GetResult());
+					}
+				}
+				catch (...)
+				{
+					exception_ = std::current_exception();
+				}
+			}
+
+			std::tuple<Task<Results>...> tasks_;
+			std::optional<ResultType> result_;
+		};
+
+		// The tasks are moved into entries stored right after the block, so one allocation covers any task count.
+		template<typename Result>
+		class WhenAnyRangeState final : public WhenAnyControl
 		{
-			co_yield {};
+			struct Entry
+			{
+				WhenAnyRangeState* state;
+				Task<Result> task;
+			};
+
+		public:
+			using ResultType = WhenAnyRangeResultType<Result>;
+
+			[[nodiscard]]
+			static WhenAnyRangeState* Create(std::span<Task<Result>> tasks)
+			{
+				void* memory = TaskAllocatorPolicy::Allocate(GetAllocationSize(tasks.size()));
+				return new (memory) WhenAnyRangeState(tasks);
+			}
+
+			// Tasks that have already completed are handled right away.
+			void Start() noexcept
+			{
+				Entry* entries = GetEntries();
+				for (std::size_t i = 0; i < taskCount_; ++i)
+				{
+					if (!entries[i].task.OnCompleted(&OnTaskCompleted, &entries[i]))
+					{
+						// Nothing is waiting yet, so there is no continuation to resume.
+						static_cast<void>(OnTaskCompleted(&entries[i]));
+					}
+				}
+			}
+
+			ResultType TakeResult()
+			{
+				RethrowIfFailed();
+				if constexpr (std::is_void_v<Result>)
+				{
+					return winner_;
+				}
+				else
+				{
+					return ResultType{ winner_, std::move(*result_) };
+				}
+			}
+
+			void Release() noexcept
+			{
+				if (DropReference())
+				{
+					const std::size_t size = GetAllocationSize(taskCount_);
+					this->~WhenAnyRangeState();
+					TaskAllocatorPolicy::Deallocate(this, size);
+				}
+			}
+
+		private:
+			explicit WhenAnyRangeState(std::span<Task<Result>> tasks) :
+				WhenAnyControl(tasks.size()),
+				taskCount_(tasks.size())
+			{
+				Entry* entries = GetEntries();
+				for (std::size_t i = 0; i < taskCount_; ++i)
+				{
+					new (&entries[i]) Entry{ this, std::move(tasks[i]) };
+				}
+			}
+
+			~WhenAnyRangeState()
+			{
+				Entry* entries = GetEntries();
+				for (std::size_t i = 0; i < taskCount_; ++i)
+				{
+					entries[i].~Entry();
+				}
+			}
+
+			[[nodiscard]]
+			static constexpr std::size_t GetEntriesOffset() noexcept
+			{
+				return (sizeof(WhenAnyRangeState) + alignof(Entry) - 1) / alignof(Entry) * alignof(Entry);
+			}
+
+			[[nodiscard]]
+			static std::size_t GetAllocationSize(std::size_t taskCount) noexcept
+			{
+				return GetEntriesOffset() + sizeof(Entry) * taskCount;
+			}
+
+			[[nodiscard]]
+			Entry* GetEntries() noexcept
+			{
+				return reinterpret_cast<Entry*>(reinterpret_cast<std::byte*>(this) + GetEntriesOffset());
+			}
+
+			static std::coroutine_handle<> OnTaskCompleted(void* context) noexcept
+			{
+				auto* entry = static_cast<Entry*>(context);
+				WhenAnyRangeState* state = entry->state;
+				std::coroutine_handle<> next = std::noop_coroutine();
+
+				if (state->TryClaim())
+				{
+					state->StoreResult(*entry);
+					next = state->Publish();
+				}
+
+				state->Release();
+				return next;
+			}
+
+			void StoreResult(Entry& entry) noexcept
+			{
+				winner_ = static_cast<std::size_t>(&entry - GetEntries());
+				try
+				{
+					if constexpr (std::is_void_v<Result>)
+					{
+						entry.task.GetResult();
+					}
+					else
+					{
+						result_.emplace(entry.task.GetResult());
+					}
+				}
+				catch (...)
+				{
+					exception_ = std::current_exception();
+				}
+			}
+
+			std::size_t taskCount_;
+			std::size_t winner_ = 0;
+			[[no_unique_address]] std::conditional_t<std::is_void_v<Result>, std::monostate, std::optional<Result>> result_;
+		};
+
+		// Kept trivially destructible for the same GCC 12 co_await issue as SleepRequest.
+		template<typename State>
+		struct WhenAnyRequest
+		{
+			State* state;
+		};
+
+		template<typename State>
+		class WhenAnyAwaiter final
+		{
+		public:
+			explicit WhenAnyAwaiter(State* state) noexcept :
+				state_(state)
+			{
+				state_->Start();
+			}
+
+			~WhenAnyAwaiter()
+			{
+				state_->StopWaiting();
+				state_->Release();
+			}
+
+			[[nodiscard]]
+			bool await_ready() const noexcept
+			{
+				return state_->IsCompleted();
+			}
+
+			bool await_suspend(std::coroutine_handle<> handle) noexcept
+			{
+				return state_->TryWait(handle);
+			}
+
+			typename State::ResultType await_resume()
+			{
+				return state_->TakeResult();
+			}
+
+			WhenAnyAwaiter(const WhenAnyAwaiter&) = delete;
+			WhenAnyAwaiter& operator=(const WhenAnyAwaiter&) = delete;
+			WhenAnyAwaiter(WhenAnyAwaiter&&) = delete;
+			WhenAnyAwaiter& operator=(WhenAnyAwaiter&&) = delete;
+
+		private:
+			State* state_;
+		};
+	}
+
+	template<typename State>
+	class AwaitTransformer<Details::WhenAnyRequest<State>>
+	{
+	public:
+		static Details::WhenAnyAwaiter<State> Transform(const Details::WhenAnyRequest<State>& request) noexcept
+		{
+			return Details::WhenAnyAwaiter<State>{ request.state };
 		}
+	};
 
-		co_return std::move(result->value());
+	// The first task to finish resumes the awaiting coroutine directly, on the thread it finished on.
+	// The other tasks keep running to completion and their results are discarded.
+	template<typename... Results>
+		requires Details::HasAnyType<Results...> && (!Details::FulfillsAllVoid<Results...>)
+	inline Task<WhenAnyResultType<Results...>> WhenAny(Task<Results>&&... tasks)
+	{
+		using State = Details::WhenAnyState<Results...>;
+		co_return co_await Details::WhenAnyRequest<State>{ State::Create(std::move(tasks)...) };
 	}
 
 	template<typename... Results>
 		requires Details::HasAnyType<Results...> && Details::FulfillsAllVoid<Results...>
 	inline Task<std::size_t> WhenAny(Task<Results>&&... tasks)
 	{
-		auto result = std::make_shared<std::optional<WhenAnyResultType<Results...>>>();
-		Details::WhenAnyHelper<0>(result, Details::ToMonostateIfVoid(std::move(tasks))...);
+		using State = Details::WhenAnyState<Results...>;
+		const auto result = co_await Details::WhenAnyRequest<State>{ State::Create(std::move(tasks)...) };
+		co_return result.index();
+	}
 
-		while (!result->has_value())
+	// Moves the tasks out of the span and returns the index of the first one to finish, with its result unless it is void.
+	// Throws std::invalid_argument for an empty span.
+	template<typename Result>
+	inline Task<WhenAnyRangeResultType<Result>> WhenAny(std::span<Task<Result>> tasks)
+	{
+		// Nothing would ever finish, so the awaiting coroutine gets an error instead of hanging.
+		if (tasks.empty())
 		{
-			co_yield {};
+			throw std::invalid_argument("WhenAny: at least one task is required");
 		}
 
-		co_return result->value().index();
+		using State = Details::WhenAnyRangeState<Result>;
+		co_return co_await Details::WhenAnyRequest<State>{ State::Create(tasks) };
 	}
 
 	template<typename Rep, typename Period>
@@ -0,0 +1,159 @@
+#ifndef TASKKIT_WORK_STEALING_DEQUE_H
+#define TASKKIT_WORK_STEALING_DEQUE_H
+
+#include <atomic>
+#include <bit>
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "CacheLine.h"
+
+namespace TKit
+{
+	// Chase-Lev work-stealing deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+	// The owner pushes and pops at the bottom; any other thread may steal from the top.
+	class WorkStealingDeque final
+	{
+		struct Buffer
+		{
+			explicit Buffer(std::size_t capacity) :
+				mask(capacity - 1),
+				slots(std::make_unique<std::atomic<void*>[]>(capacity))
+			{
+			}
+
+			[[nodiscard]]
+			std::size_t GetCapacity() const noexcept
+			{
+				return mask + 1;
+			}
+
+			void Store(std::int64_t index, void* value) noexcept
+			{
+				slots[static_cast<std::size_t>(index) & mask].store(value, std::memory_order_relaxed);
+			}
+
+			[[nodiscard]]
+			void* Load(std::int64_t index) const noexcept
+			{
+				return slots[static_cast<std::size_t>(index) & mask].load(std::memory_order_relaxed);
+			}
+
+			std::size_t mask;
+			std::unique_ptr<std::atomic<void*>[]> slots;
+		};
+
+	public:
+		explicit WorkStealingDeque(std::size_t capacity = 128)
+		{
+			buffers_.push_back(std::make_unique<Buffer>(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity)));
+			buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+		}
+
+		// Owner thread only.
+		void Push(std::coroutine_handle<> handle)
+		{
+			const std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+			const std::int64_t top = top_.load(std::memory_order_acquire);
+			Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+
+			if (bottom - top >= static_cast<std::int64_t>(buffer->GetCapacity()))
+			{
+				buffer = Grow(buffer, top, bottom);
+			}
+
+			buffer->Store(bottom, handle.address());
+			bottom_.store(bottom + 1, std::memory_order_release);
+		}
+
+		// Owner thread only. Returns the most recently pushed handle, or a null handle when empty.
+		[[nodiscard]]
+		std::coroutine_handle<> Pop() noexcept
+		{
+			const std::int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+			Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+			bottom_.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			std::int64_t top = top_.load(std::memory_order_relaxed);
+
+			if (top > bottom)
+			{
+				bottom_.store(bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			void* value = buffer->Load(bottom);
+			if (top == bottom)
+			{
+				if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					value = nullptr;
+				}
+				bottom_.store(bottom + 1, std::memory_order_relaxed);
+			}
+
+			return std::coroutine_handle<>::from_address(value);
+		}
+
+		// Any thread. Returns the oldest handle, or a null handle when empty or when another thread won the race.
+		[[nodiscard]]
+		std::coroutine_handle<> Steal() noexcept
+		{
+			std::int64_t top = top_.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const std::int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+			if (top >= bottom)
+			{
+				return nullptr;
+			}
+
+			const Buffer* buffer = buffer_.load(std::memory_order_acquire);
+			void* value = buffer->Load(top);
+			if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+
+			return std::coroutine_handle<>::from_address(value);
+		}
+
+		[[nodiscard]]
+		std::size_t GetApproximateSize() const noexcept
+		{
+			const std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+			const std::int64_t top = top_.load(std::memory_order_relaxed);
+			return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
+		}
+
+		WorkStealingDeque(const WorkStealingDeque&) = delete;
+		WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+		WorkStealingDeque(WorkStealingDeque&&) = delete;
+		WorkStealingDeque& operator=(WorkStealingDeque&&) = delete;
+
+	private:
+		Buffer* Grow(const Buffer* buffer, std::int64_t top, std::int64_t bottom)
+		{
+			// Retired buffers stay alive until destruction because a thief may still be reading from them.
+			auto grown = std::make_unique<Buffer>(buffer->GetCapacity() * 2);
+			for (std::int64_t i = top; i < bottom; ++i)
+			{
+				grown->Store(i, buffer->Load(i));
+			}
+
+			Buffer* result = grown.get();
+			buffers_.push_back(std::move(grown));
+			buffer_.store(result, std::memory_order_release);
+			return result;
+		}
+
+		// Thieves move top and the owner moves bottom; the buffer pointer rarely changes and is kept off both lines.
+		alignas(Details::CacheLineSize) std::atomic<std::int64_t> top_{0};
+		alignas(Details::CacheLineSize) std::atomic<std::int64_t> bottom_{0};
+		alignas(Details::CacheLineSize) std::atomic<Buffer*> buffer_{nullptr};
+		std::vector<std::unique_ptr<Buffer>> buffers_;
+	};
+}
+
+#endif //TASKKIT_WORK_STEALING_DEQUE_H
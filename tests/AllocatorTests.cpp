@@ -1,4 +1,12 @@
 #include "TestBase.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <latch>
+#include <memory_resource>
+#include <thread>
+#include <vector>
 
 namespace TKit::Tests
 {
@@ -153,6 +161,280 @@ namespace TKit::Tests
 		TaskSystem::Shutdown();
 	}
 
+	TEST_F(AllocatorTests, PrewarmedFramesWithDefaultAllocator)
+	{
+		const auto config = TaskSystemConfiguration::Builder()
+			.WithPrewarmedFrames(128, 1000)
+			.WithPrewarmedFrames(512, 100)
+			.Build();
+
+		TaskSystem::Initialize(config);
+
+		const auto schedulerId = TaskSystem::CreateScheduler();
+		{
+			auto registration = TaskSystem::ActivateScheduler(schedulerId);
+
+			int completed = 0;
+			auto task = [&]() -> Task<>
+			{
+				co_yield {};
+				++completed;
+				co_return;
+			};
+
+			for (int i = 0; i < 100; ++i)
+			{
+				task().Forget();
+			}
+
+			TaskSystem::UpdateActivatedScheduler();
+			EXPECT_EQ(completed, 100);
+		}
+
+		CheckPendingTasksAreZero(schedulerId);
+		TaskSystem::Shutdown();
+	}
+
+	TEST_F(AllocatorTests, FrameArenaRewindsAfterUpdate)
+	{
+		PoolAllocator pool;
+		FrameArenaAllocator arena(pool.CreateTaskAllocator());
+		void* arenaStart = arena.Allocate(1);
+		arena.Deallocate(arenaStart, 1);
+
+		TaskSystem::Initialize(TaskSystemConfiguration::Builder()
+			.WithCustomAllocator(arena.CreateTaskAllocator())
+			.Build());
+
+		const auto schedulerId = TaskSystem::CreateScheduler();
+		{
+			auto registration = TaskSystem::ActivateScheduler(schedulerId);
+
+			int completed = 0;
+			auto task = [&]() -> Task<>
+			{
+				co_yield {};
+				++completed;
+				co_return;
+			};
+
+			for (int i = 0; i < 100; ++i)
+			{
+				task().Forget();
+			}
+
+			TaskSystem::UpdateActivatedScheduler();
+			EXPECT_EQ(completed, 100);
+		}
+
+		CheckPendingTasksAreZero(schedulerId);
+		TaskSystem::Shutdown();
+
+		EXPECT_EQ(arena.Allocate(1), arenaStart) << "Every frame finished within the update, so the arena starts over";
+		arena.Deallocate(arenaStart, 1);
+	}
+
+	TEST_F(AllocatorTests, DynamicPolicyUsesConfiguredAllocator)
+	{
+		int allocCount = 0;
+		const TaskAllocator countingAllocator(
+			&allocCount,
+			[](void* ctx, std::size_t size) -> void*
+			{
+				++*static_cast<int*>(ctx);
+				return ::operator new(size);
+			},
+			nullptr);
+
+		TaskSystem::Initialize(TaskSystemConfiguration::Builder().WithCustomAllocator(countingAllocator).Build());
+
+		void* ptr = DynamicAllocatorPolicy::Allocate(64);
+		EXPECT_EQ(allocCount, 1);
+		DynamicAllocatorPolicy::Deallocate(ptr, 64);
+
+		TaskSystem::Shutdown();
+	}
+
+	TEST_F(AllocatorTests, PoolPolicyUsesProcessWidePool)
+	{
+		void* ptr = PoolAllocatorPolicy::Allocate(64);
+		PoolAllocatorPolicy::Deallocate(ptr, 64);
+		EXPECT_EQ(PoolAllocatorPolicy::GetPoolAllocator().Allocate(64), ptr) << "Both paths should share one pool";
+		PoolAllocatorPolicy::Deallocate(ptr, 64);
+	}
+
+	TEST_F(AllocatorTests, MemoryResourceSharesFramePool)
+	{
+		TaskSystem::Initialize();
+
+		auto* resource = dynamic_cast<PoolMemoryResource*>(TaskSystem::GetMemoryResource());
+		ASSERT_NE(resource, nullptr);
+
+		std::latch latch{1};
+		std::size_t total = 0;
+		auto task = [&]() -> Task<>
+		{
+			{
+				std::pmr::vector<std::size_t> values(TaskSystem::GetMemoryResource());
+				for (std::size_t i = 0; i < 100; ++i)
+				{
+					values.push_back(i);
+				}
+
+				// Built on the main thread and released on a worker, through the pool's remote frees.
+				co_await SwitchToThreadPool();
+				for (const std::size_t value : values)
+				{
+					total += value;
+				}
+			}
+			latch.count_down();
+		};
+
+		task().Forget();
+		latch.wait();
+		EXPECT_EQ(total, 4950u);
+
+		void* block = resource->GetAllocator().Allocate(64);
+		EXPECT_TRUE(resource->is_equal(PoolMemoryResource(resource->GetAllocator())));
+		resource->GetAllocator().Deallocate(block, 64);
+
+		TaskSystem::Shutdown();
+	}
+
+	TEST_F(AllocatorTests, MemoryResourceWithCustomAllocatorUsesHeap)
+	{
+		TaskSystem::Initialize(TaskSystemConfiguration::Builder().WithCustomAllocator(TaskAllocator{}).Build());
+		EXPECT_EQ(TaskSystem::GetMemoryResource(), std::pmr::new_delete_resource());
+		TaskSystem::Shutdown();
+	}
+
+	TEST_F(AllocatorTests, ProducerWaitsForFrameBudget)
+	{
+		constexpr std::size_t frameBudget = 16 * 1024;
+		TaskSystem::Initialize(TaskSystemConfiguration::Builder()
+			.WithPoolAllocator(PoolAllocatorConfiguration::Builder().WithMemoryBudget(frameBudget, MemoryBudgetPolicy::Gate).Build())
+			.Build());
+
+		const auto schedulerId = TaskSystem::CreateScheduler();
+		{
+			auto registration = TaskSystem::ActivateScheduler(schedulerId);
+
+			constexpr int taskCount = 200;
+			int liveCount = 0;
+			int maxLiveCount = 0;
+			int completed = 0;
+			auto consumer = [&]() -> Task<>
+			{
+				// Lives across the suspension, so it is part of the frame.
+				std::array<char, 1024> payload{};
+				payload.back() = 1;
+				++liveCount;
+				maxLiveCount = std::max(maxLiveCount, liveCount);
+				co_yield {};
+				EXPECT_EQ(payload.back(), 1);
+				--liveCount;
+				++completed;
+				co_return;
+			};
+
+			bool isProducerDone = false;
+			auto producer = [&]() -> Task<>
+			{
+				for (int i = 0; i < taskCount; ++i)
+				{
+					co_await TaskSystem::WaitForFrameBudget();
+					consumer().Forget();
+				}
+				isProducerDone = true;
+			};
+			producer().Forget();
+
+			for (int update = 0; update < 2 * taskCount && !isProducerDone; ++update)
+			{
+				TaskSystem::UpdateActivatedScheduler();
+			}
+			TaskSystem::UpdateActivatedScheduler();
+
+			EXPECT_TRUE(isProducerDone);
+			EXPECT_EQ(completed, taskCount);
+			EXPECT_LE(static_cast<std::size_t>(maxLiveCount), frameBudget / 1024 + 1) << "The producer held back once the budget was spent";
+		}
+
+		CheckPendingTasksAreZero(schedulerId);
+		TaskSystem::Shutdown();
+	}
+
+	TEST_F(AllocatorTests, ProducerWaitsForFramesFreedOnWorkers)
+	{
+		// Enough workers that their combined credit could hold the whole budget if idle threads kept it.
+		constexpr std::size_t frameBudget = 16 * 1024;
+		constexpr std::size_t workerCount = 40;
+		TaskSystem::Initialize(TaskSystemConfiguration::Builder()
+			.WithPoolAllocator(PoolAllocatorConfiguration::Builder().WithMemoryBudget(frameBudget, MemoryBudgetPolicy::Gate).Build())
+			.WithThreadPoolSize(workerCount)
+			.Build());
+
+		const auto schedulerId = TaskSystem::CreateScheduler();
+		{
+			auto registration = TaskSystem::ActivateScheduler(schedulerId);
+
+			constexpr int taskCount = 400;
+			std::atomic<int> liveCount{0};
+			std::atomic<int> maxLiveCount{0};
+			std::atomic<int> completed{0};
+			auto consumer = [&]() -> Task<>
+			{
+				std::array<char, 1024> payload{};
+				payload.back() = 1;
+				const int live = liveCount.fetch_add(1) + 1;
+				int maxLive = maxLiveCount.load();
+				while (live > maxLive && !maxLiveCount.compare_exchange_weak(maxLive, live))
+				{
+				}
+
+				// The frame is freed on a worker, which hands the budget back.
+				co_await SwitchToThreadPool();
+				EXPECT_EQ(payload.back(), 1);
+				liveCount.fetch_sub(1);
+				completed.fetch_add(1);
+			};
+
+			bool isProducerDone = false;
+			auto producer = [&]() -> Task<>
+			{
+				for (int i = 0; i < taskCount; ++i)
+				{
+					co_await TaskSystem::WaitForFrameBudget();
+					consumer().Forget();
+				}
+				isProducerDone = true;
+			};
+			producer().Forget();
+
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+			while ((!isProducerDone || completed.load() < taskCount) && std::chrono::steady_clock::now() < deadline)
+			{
+				TaskSystem::UpdateActivatedScheduler();
+				std::this_thread::yield();
+			}
+			ASSERT_TRUE(isProducerDone) << "The producer must resume once workers free its frames";
+			EXPECT_EQ(completed.load(), taskCount);
+			EXPECT_LE(static_cast<std::size_t>(maxLiveCount.load()), frameBudget / 1024 + 1);
+
+			// Idle workers give their credit back, so nothing stays charged once every frame is gone.
+			while (TaskSystem::GetAllocatorStats().budgetUsedBytes != 0 && std::chrono::steady_clock::now() < deadline)
+			{
+				TaskSystem::UpdateActivatedScheduler();
+				std::this_thread::yield();
+			}
+			EXPECT_EQ(TaskSystem::GetAllocatorStats().budgetUsedBytes, 0u);
+		}
+
+		CheckPendingTasksAreZero(schedulerId);
+		TaskSystem::Shutdown();
+	}
+
 	TEST_F(AllocatorTests, PoolAllocatorReuse)
 	{
 		int actualNewCalls = 0;
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "details/FrameArenaAllocator.h"
+#include "details/PoolAllocator.h"
+
+namespace TKit::Tests
+{
+	class FrameArenaAllocatorTests : public ::testing::Test
+	{
+	protected:
+		static constexpr std::size_t ChunkSize = 1024;
+		static constexpr std::size_t ChunkCount = 2;
+		PoolAllocator pool_;
+		FrameArenaAllocator arena_{pool_.CreateTaskAllocator(), ChunkSize, ChunkCount};
+	};
+
+	TEST_F(FrameArenaAllocatorTests, BumpsAndRewindsAtFrameEnd)
+	{
+		void* first = arena_.Allocate(40);
+		void* second = arena_.Allocate(40);
+		ASSERT_TRUE(arena_.Owns(first));
+		EXPECT_EQ(static_cast<char*>(second), static_cast<char*>(first) + 48);
+
+		arena_.Deallocate(first, 40);
+		arena_.Deallocate(second, 40);
+		EXPECT_EQ(arena_.Allocate(40), static_cast<char*>(first) + 96) << "Rewinding waits for the end of the frame";
+
+		arena_.Deallocate(static_cast<char*>(first) + 96, 40);
+		arena_.EndFrame();
+		EXPECT_EQ(arena_.Allocate(40), first);
+		arena_.Deallocate(first, 40);
+	}
+
+	TEST_F(FrameArenaAllocatorTests, SurvivorPinsItsChunk)
+	{
+		void* survivor = arena_.Allocate(64);
+		arena_.EndFrame();
+
+		// Fill the rest of the survivor's chunk, then spill into the other one.
+		std::vector<void*> frames;
+		for (std::size_t i = 0; i < ChunkSize / 64; ++i)
+		{
+			frames.push_back(arena_.Allocate(64));
+		}
+		void* spilled = frames.back();
+		EXPECT_TRUE(arena_.Owns(spilled));
+		EXPECT_GE(static_cast<char*>(spilled), static_cast<char*>(survivor) + ChunkSize);
+
+		for (void* frame : frames)
+		{
+			arena_.Deallocate(frame, 64);
+		}
+		arena_.EndFrame();
+		EXPECT_EQ(arena_.Allocate(64), spilled) << "The chunk without survivors should be rewound";
+		arena_.Deallocate(spilled, 64);
+		arena_.Deallocate(survivor, 64);
+	}
+
+	TEST_F(FrameArenaAllocatorTests, FallsBackWhenArenaCannotServe)
+	{
+		void* large = arena_.Allocate(ChunkSize + 1);
+		EXPECT_FALSE(arena_.Owns(large));
+		arena_.Deallocate(large, ChunkSize + 1);
+
+		void* remote = nullptr;
+		std::thread otherThread([&]()
+		{
+			remote = arena_.Allocate(64);
+		});
+		otherThread.join();
+		EXPECT_FALSE(arena_.Owns(remote)) << "Only the owner thread bumps";
+		arena_.Deallocate(remote, 64);
+
+		std::vector<void*> frames;
+		for (std::size_t i = 0; i < ChunkCount; ++i)
+		{
+			frames.push_back(arena_.Allocate(ChunkSize));
+		}
+		void* overflow = arena_.Allocate(64);
+		EXPECT_FALSE(arena_.Owns(overflow)) << "Every chunk is pinned";
+		arena_.Deallocate(overflow, 64);
+
+		for (void* frame : frames)
+		{
+			EXPECT_TRUE(arena_.Owns(frame));
+			arena_.Deallocate(frame, ChunkSize);
+		}
+	}
+
+	TEST_F(FrameArenaAllocatorTests, FramesFreedOnOtherThreadsUnpinChunk)
+	{
+		void* frame = arena_.Allocate(64);
+		std::thread otherThread([&]()
+		{
+			arena_.Deallocate(frame, 64);
+		});
+		otherThread.join();
+
+		arena_.EndFrame();
+		EXPECT_EQ(arena_.Allocate(64), frame);
+		arena_.Deallocate(frame, 64);
+	}
+}
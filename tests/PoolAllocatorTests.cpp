@@ -4,7 +4,15 @@
 #include <atomic>
 #include <algorithm>
 #include <set>
+#include <cstring>
+#include <fstream>
+#include <memory>
 #include "details/PoolAllocator.h"
+#include "details/PoolMemoryResource.h"
+
+#if TASKKIT_HAS_MMAP
+#include <unistd.h>
+#endif
 
 namespace TKit::Tests
 {
@@ -36,6 +44,574 @@ namespace TKit::Tests
 		allocator_.Deallocate(ptr4, 64);
 	}
 
+	TEST_F(PoolAllocatorTests, BlocksArePackedWithoutHeaders)
+	{
+		constexpr std::size_t size = 64;
+		void* first = allocator_.Allocate(size);
+		void* second = allocator_.Allocate(size);
+		void* third = allocator_.Allocate(size);
+
+		EXPECT_EQ(static_cast<char*>(second) - static_cast<char*>(first), static_cast<std::ptrdiff_t>(size));
+		EXPECT_EQ(static_cast<char*>(third) - static_cast<char*>(second), static_cast<std::ptrdiff_t>(size));
+
+		allocator_.Deallocate(first, size);
+		allocator_.Deallocate(second, size);
+		allocator_.Deallocate(third, size);
+	}
+
+	TEST_F(PoolAllocatorTests, AllocationsAreMaxAligned)
+	{
+		std::vector<std::pair<void*, std::size_t>> allocations;
+		for (const std::size_t size : { std::size_t{1}, std::size_t{24}, std::size_t{130}, std::size_t{8192}, std::size_t{PoolAllocator::SlabSize * 2} })
+		{
+			void* ptr = allocator_.Allocate(size);
+			EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % alignof(std::max_align_t), 0u);
+			allocations.emplace_back(ptr, size);
+		}
+
+		for (const auto& [ptr, size] : allocations)
+		{
+			allocator_.Deallocate(ptr, size);
+		}
+	}
+
+	TEST_F(PoolAllocatorTests, SlabRunsGrowGeometrically)
+	{
+		// The largest class fits a handful of blocks per slab, so a few runs are enough to see the doubling.
+		constexpr std::size_t size = PoolAllocator::PoolSizes.back();
+		constexpr std::size_t blocksPerSlab = (PoolAllocator::SlabSize - 64) / size;
+
+		std::vector<void*> pointers;
+		for (std::size_t i = 0; i < blocksPerSlab * 7; ++i)
+		{
+			pointers.push_back(allocator_.Allocate(size));
+		}
+
+		// Runs of 1, 2 and 4 slabs: each run is one contiguous allocation.
+		const auto span = [&](std::size_t first, std::size_t count)
+		{
+			const auto [low, high] = std::minmax_element(pointers.begin() + first, pointers.begin() + first + count);
+			return static_cast<std::size_t>(static_cast<char*>(*high) - static_cast<char*>(*low));
+		};
+		EXPECT_LT(span(blocksPerSlab, blocksPerSlab * 2), PoolAllocator::SlabSize * 2);
+		EXPECT_LT(span(blocksPerSlab * 3, blocksPerSlab * 4), PoolAllocator::SlabSize * 4);
+
+		for (void* ptr : pointers)
+		{
+			allocator_.Deallocate(ptr, size);
+		}
+	}
+
+	TEST_F(PoolAllocatorTests, ReserveCarvesFromOneRun)
+	{
+		constexpr std::size_t size = 256;
+		constexpr std::size_t count = 5000;
+		allocator_.Reserve(size, count);
+
+		std::vector<void*> pointers;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			pointers.push_back(allocator_.Allocate(size));
+		}
+
+		const auto [low, high] = std::minmax_element(pointers.begin(), pointers.end());
+		const std::size_t slabCount = (count + PoolAllocator::SlabSize / size - 2) / (PoolAllocator::SlabSize / size - 1);
+		EXPECT_LT(static_cast<std::size_t>(static_cast<char*>(*high) - static_cast<char*>(*low)), slabCount * PoolAllocator::SlabSize);
+
+		for (void* ptr : pointers)
+		{
+			allocator_.Deallocate(ptr, size);
+		}
+	}
+
+	TEST_F(PoolAllocatorTests, TrimReleasesOnlyFullyFreeRuns)
+	{
+		constexpr std::size_t size = 256;
+		void* first = allocator_.Allocate(size);
+		void* second = allocator_.Allocate(size);
+
+		allocator_.Deallocate(first, size);
+		EXPECT_EQ(allocator_.Trim(), 0u) << "A run with a live block must be kept";
+
+		allocator_.Deallocate(second, size);
+		EXPECT_EQ(allocator_.Trim(), PoolAllocator::SlabSize);
+		EXPECT_EQ(allocator_.Trim(), 0u);
+
+		// The class starts over from a fresh run after its memory was released.
+		void* third = allocator_.Allocate(size);
+		ASSERT_NE(third, nullptr);
+		allocator_.Deallocate(third, size);
+	}
+
+	TEST_F(PoolAllocatorTests, TrimResetsRunGrowth)
+	{
+		// Enough blocks that the class grows its runs to the largest size.
+		constexpr std::size_t size = 256;
+		std::vector<void*> pointers;
+		for (int i = 0; i < 10000; ++i)
+		{
+			pointers.push_back(allocator_.Allocate(size));
+		}
+		for (void* ptr : pointers)
+		{
+			allocator_.Deallocate(ptr, size);
+		}
+		EXPECT_GT(allocator_.Trim(), 0u);
+		EXPECT_EQ(allocator_.GetStats().reservedBytes, 0u);
+
+		void* ptr = allocator_.Allocate(size);
+		EXPECT_EQ(allocator_.GetStats().reservedBytes, PoolAllocator::SlabSize) << "A trimmed class starts over from a single slab";
+		allocator_.Deallocate(ptr, size);
+	}
+
+	TEST_F(PoolAllocatorTests, TrimCollectsRemoteFrees)
+	{
+		constexpr std::size_t size = 64;
+		std::vector<void*> pointers;
+		for (int i = 0; i < 100; ++i)
+		{
+			pointers.push_back(allocator_.Allocate(size));
+		}
+
+		std::thread remoteThread([&]()
+		{
+			for (void* ptr : pointers)
+			{
+				allocator_.Deallocate(ptr, size);
+			}
+		});
+		remoteThread.join();
+
+		EXPECT_EQ(allocator_.Trim(), PoolAllocator::SlabSize);
+	}
+
+	TEST_F(PoolAllocatorTests, HighWaterMarkTrimsAfterSpike)
+	{
+		PoolAllocator allocator(PoolAllocatorConfiguration::Builder()
+			.WithHighWaterMark(PoolAllocator::SlabSize * 4)
+			.Build());
+
+		constexpr std::size_t size = 256;
+		std::vector<void*> pointers;
+		for (int i = 0; i < 20000; ++i)
+		{
+			pointers.push_back(allocator.Allocate(size));
+		}
+
+		for (void* ptr : pointers)
+		{
+			allocator.Deallocate(ptr, size);
+		}
+
+		EXPECT_EQ(allocator.Trim(), 0u) << "Freeing below the high-water mark should already have trimmed";
+	}
+
+	TEST_F(PoolAllocatorTests, RemoteFreesArePublishedInBatches)
+	{
+		constexpr std::size_t size = 64;
+		std::vector<void*> pointers;
+		for (std::size_t i = 0; i < PoolAllocator::RemoteFreeBatchSize + 1; ++i)
+		{
+			pointers.push_back(allocator_.Allocate(size));
+		}
+
+		std::atomic<int> step{0};
+		std::thread remoteThread([&]()
+		{
+			allocator_.Deallocate(pointers.back(), size);
+			step.store(1, std::memory_order_release);
+			step.wait(1, std::memory_order_acquire);
+
+			for (std::size_t i = 0; i < PoolAllocator::RemoteFreeBatchSize; ++i)
+			{
+				allocator_.Deallocate(pointers[i], size);
+			}
+			step.store(3, std::memory_order_release);
+			step.notify_one();
+			step.wait(3, std::memory_order_acquire);
+
+			allocator_.FlushRemoteFrees();
+			step.store(5, std::memory_order_release);
+			step.notify_one();
+		});
+
+		step.wait(0, std::memory_order_acquire);
+		EXPECT_EQ(allocator_.Trim(), 0u) << "A single remote free should wait in the freeing thread's batch";
+		step.store(2, std::memory_order_release);
+		step.notify_one();
+
+		step.wait(2, std::memory_order_acquire);
+		void* reused = allocator_.Allocate(size);
+		EXPECT_NE(std::find(pointers.begin(), pointers.end(), reused), pointers.end())
+			<< "A full batch should be published without a flush";
+		allocator_.Deallocate(reused, size);
+		step.store(4, std::memory_order_release);
+		step.notify_one();
+
+		step.wait(4, std::memory_order_acquire);
+		EXPECT_EQ(allocator_.Trim(), PoolAllocator::SlabSize);
+		remoteThread.join();
+	}
+
+	TEST_F(PoolAllocatorTests, AlternatingAllocatorsKeepTheirThreadPools)
+	{
+		constexpr std::size_t size = 64;
+		constexpr std::size_t rounds = 8;
+		std::vector<std::unique_ptr<PoolAllocator>> allocators;
+		for (std::size_t i = 0; i < PoolAllocator::ThreadPoolCacheSize + 2; ++i)
+		{
+			allocators.push_back(std::make_unique<PoolAllocator>());
+		}
+
+		// More allocators than the cache holds, so every round evicts entries that the next round finds again.
+		std::vector<std::vector<void*>> pointers(allocators.size());
+		for (std::size_t round = 0; round < rounds; ++round)
+		{
+			for (std::size_t i = 0; i < allocators.size(); ++i)
+			{
+				pointers[i].push_back(allocators[i]->Allocate(size));
+			}
+		}
+
+		const std::size_t poolIndex = static_cast<std::size_t>(PoolAllocator::FindPoolIndex(size));
+		for (std::size_t i = 0; i < allocators.size(); ++i)
+		{
+			const PoolAllocator::Stats stats = allocators[i]->GetStats();
+			EXPECT_EQ(stats.threads.size(), 1u);
+			EXPECT_EQ(stats.sizeClasses[poolIndex].liveBlocks, rounds);
+			EXPECT_EQ(static_cast<char*>(pointers[i][1]) - static_cast<char*>(pointers[i][0]), static_cast<std::ptrdiff_t>(size))
+				<< "Each allocator keeps carving from the same pool";
+
+			for (void* ptr : pointers[i])
+			{
+				allocators[i]->Deallocate(ptr, size);
+			}
+		}
+
+		// A destroyed allocator's entries are dropped and never match a new one.
+		allocators.front() = std::make_unique<PoolAllocator>();
+		void* ptr = allocators.front()->Allocate(size);
+		EXPECT_EQ(allocators.front()->GetStats().sizeClasses[poolIndex].liveBlocks, 1u);
+		allocators.front()->Deallocate(ptr, size);
+	}
+
+	TEST_F(PoolAllocatorTests, ExitedThreadPoolIsAdopted)
+	{
+		constexpr std::size_t size = 64;
+		void* kept = nullptr;
+		void* freed = nullptr;
+
+		// The kept block holds the run, so the exiting thread's trim leaves the freed block on its pool.
+		std::thread exitingThread([&]()
+		{
+			kept = allocator_.Allocate(size);
+			freed = allocator_.Allocate(size);
+			allocator_.Deallocate(freed, size);
+		});
+		exitingThread.join();
+
+		void* reused = nullptr;
+		std::thread adoptingThread([&]()
+		{
+			reused = allocator_.Allocate(size);
+			allocator_.Deallocate(reused, size);
+			allocator_.Deallocate(kept, size);
+		});
+		adoptingThread.join();
+
+		EXPECT_EQ(reused, freed) << "A new thread should adopt the exited thread's pool";
+	}
+
+	TEST_F(PoolAllocatorTests, TrimReleasesOrphanedPool)
+	{
+		constexpr std::size_t size = 64;
+		void* ptr = nullptr;
+		std::thread exitingThread([&]()
+		{
+			ptr = allocator_.Allocate(size);
+		});
+		exitingThread.join();
+
+		allocator_.Deallocate(ptr, size);
+		EXPECT_EQ(allocator_.Trim(), PoolAllocator::SlabSize) << "The remote free should empty the orphaned pool's run";
+		EXPECT_EQ(allocator_.Trim(), 0u);
+	}
+
+	TEST_F(PoolAllocatorTests, MemoryResourceHonoursAlignment)
+	{
+		PoolMemoryResource resource(allocator_);
+
+		for (const std::size_t alignment : { std::size_t{8}, std::size_t{16}, std::size_t{64}, std::size_t{256}, std::size_t{4096} })
+		{
+			void* ptr = resource.allocate(100, alignment);
+			EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % alignment, 0u) << "alignment " << alignment;
+			std::memset(ptr, 0xAB, 100);
+			resource.deallocate(ptr, 100, alignment);
+		}
+
+		void* block = allocator_.Allocate(64);
+		allocator_.Deallocate(block, 64);
+		void* ptr = resource.allocate(64, 16);
+		EXPECT_EQ(ptr, block) << "Max-aligned requests should come straight from the pool";
+		resource.deallocate(ptr, 64, 16);
+
+		PoolMemoryResource sameAllocator(allocator_);
+		PoolAllocator otherAllocator;
+		PoolMemoryResource differentAllocator(otherAllocator);
+		EXPECT_TRUE(resource.is_equal(sameAllocator));
+		EXPECT_FALSE(resource.is_equal(differentAllocator));
+		EXPECT_FALSE(resource.is_equal(*std::pmr::new_delete_resource()));
+	}
+
+	TEST_F(PoolAllocatorTests, StatsTrackBlocksPerClassAndThread)
+	{
+		constexpr std::size_t size = 40;
+		const std::size_t poolIndex = static_cast<std::size_t>(PoolAllocator::FindPoolIndex(size));
+
+		std::vector<void*> pointers;
+		for (int i = 0; i < 10; ++i)
+		{
+			pointers.push_back(allocator_.Allocate(size));
+		}
+		allocator_.Deallocate(pointers.back(), size);
+		pointers.pop_back();
+
+		std::thread remoteThread([&]()
+		{
+			allocator_.Deallocate(pointers.back(), size);
+			void* large = allocator_.Allocate(20000);
+			allocator_.Deallocate(large, 20000);
+		});
+		remoteThread.join();
+		pointers.pop_back();
+
+		// Remote frees count as live until the owner collects them.
+		EXPECT_EQ(allocator_.GetStats().sizeClasses[poolIndex].liveBlocks, 9u);
+		EXPECT_EQ(allocator_.Trim(), 0u);
+
+		const PoolAllocator::Stats stats = allocator_.GetStats();
+		const auto& sizeClass = stats.sizeClasses[poolIndex];
+		EXPECT_EQ(sizeClass.blockSize, PoolAllocator::PoolSizes[poolIndex]);
+		EXPECT_EQ(sizeClass.liveBlocks, 8u);
+		EXPECT_EQ(sizeClass.freeBlocks, 2u);
+		EXPECT_EQ(sizeClass.slabs, 1u);
+		EXPECT_EQ(sizeClass.remoteFreesReceived, 1u);
+		EXPECT_EQ(sizeClass.allocations, 10u);
+		EXPECT_EQ(sizeClass.wastedBytes, 10u * (sizeClass.blockSize - size));
+		EXPECT_EQ(stats.reservedBytes, PoolAllocator::SlabSize);
+		EXPECT_EQ(stats.largeAllocations, 1u);
+		EXPECT_EQ(stats.largeCachedBytes, 0u) << "The exited thread's cache is released when its pool is orphaned";
+		EXPECT_EQ(stats.threads.size(), 1u) << "Trim drops the exited thread's empty pool but keeps its counts";
+
+		const auto mainThread = std::find_if(stats.threads.begin(), stats.threads.end(), [](const auto& thread)
+		{
+			return thread.threadId == std::this_thread::get_id();
+		});
+		ASSERT_NE(mainThread, stats.threads.end());
+		EXPECT_EQ(mainThread->sizeClasses[poolIndex].liveBlocks, 8u);
+
+		for (void* ptr : pointers)
+		{
+			allocator_.Deallocate(ptr, size);
+		}
+		EXPECT_EQ(allocator_.GetStats().sizeClasses[poolIndex].liveBlocks, 0u);
+	}
+
+	TEST_F(PoolAllocatorTests, CustomSizeClassesFitObservedFrames)
+	{
+		PoolAllocator allocator(PoolAllocatorConfiguration::Builder().WithSizeClasses({ 80, 160, 352 }).Build());
+		ASSERT_EQ(allocator.GetPoolSizes().size(), 3u);
+		EXPECT_EQ(allocator.GetPoolIndex(72), 0);
+		EXPECT_EQ(allocator.GetPoolIndex(152), 1);
+		EXPECT_EQ(allocator.GetPoolIndex(344), 2);
+		EXPECT_EQ(allocator.GetPoolIndex(353), -1) << "Sizes past the last class take the large-block path";
+
+		std::vector<void*> pointers;
+		for (const std::size_t size : { 72, 72, 152, 344, 1000 })
+		{
+			pointers.push_back(allocator.Allocate(size));
+		}
+		EXPECT_EQ(static_cast<char*>(pointers[1]) - static_cast<char*>(pointers[0]), 80);
+
+		const PoolAllocator::Stats stats = allocator.GetStats();
+		ASSERT_EQ(stats.sizeClasses.size(), 3u);
+		EXPECT_EQ(stats.sizeClasses[0].blockSize, 80u);
+		EXPECT_EQ(stats.sizeClasses[0].wastedBytes, 16u);
+		EXPECT_EQ(stats.sizeClasses[1].wastedBytes, 8u);
+		EXPECT_EQ(stats.sizeClasses[2].wastedBytes, 8u);
+		EXPECT_EQ(stats.largeAllocations, 1u);
+
+		for (void* ptr : pointers)
+		{
+			allocator.Deallocate(ptr, 0);
+		}
+	}
+
+	TEST_F(PoolAllocatorTests, SizeHistogramCountsRequestsPerStep)
+	{
+		EXPECT_TRUE(allocator_.GetSizeHistogram().sizes.empty()) << "Recording is off by default";
+
+		PoolAllocator allocator(PoolAllocatorConfiguration::Builder().WithSizeHistogram().Build());
+		std::vector<std::pair<void*, std::size_t>> blocks;
+		for (const std::size_t size : { 72, 72, 80, 152 })
+		{
+			blocks.emplace_back(allocator.Allocate(size), size);
+		}
+		std::thread otherThread([&]()
+		{
+			allocator.Deallocate(allocator.Allocate(344), 344);
+			allocator.Deallocate(allocator.Allocate(20000), 20000);
+		});
+		otherThread.join();
+
+		const PoolAllocator::SizeHistogram histogram = allocator.GetSizeHistogram();
+		ASSERT_EQ(histogram.sizes.size(), 3u);
+		EXPECT_EQ(histogram.sizes[0].size, 80u);
+		EXPECT_EQ(histogram.sizes[0].count, 3u);
+		EXPECT_EQ(histogram.sizes[1].size, 160u);
+		EXPECT_EQ(histogram.sizes[1].count, 1u);
+		EXPECT_EQ(histogram.sizes[2].size, 352u);
+		EXPECT_EQ(histogram.sizes[2].count, 1u);
+		EXPECT_EQ(histogram.largeCount, 1u);
+
+		for (const auto& [ptr, size] : blocks)
+		{
+			allocator.Deallocate(ptr, size);
+		}
+	}
+
+	TEST_F(PoolAllocatorTests, FitSizeClassesMinimisesWaste)
+	{
+		PoolAllocator::SizeHistogram histogram;
+		histogram.sizes = { { 80, 10 }, { 96, 1 }, { 160, 5 }, { 352, 7 } };
+
+		// The rare 96-byte frames cost the least when they share the 160-byte class.
+		const std::vector<std::size_t> expected = { 80, 160, 352, Details::MaxPoolSize };
+		EXPECT_EQ(PoolAllocator::FitSizeClasses(histogram, 4), expected);
+
+		const std::vector<std::size_t> exact = { 80, 96, 160, 352, Details::MaxPoolSize };
+		EXPECT_EQ(PoolAllocator::FitSizeClasses(histogram), exact);
+		EXPECT_EQ(PoolAllocator::FitSizeClasses({}, 1), std::vector<std::size_t>{ Details::MaxPoolSize });
+
+		PoolAllocator allocator(PoolAllocatorConfiguration::Builder().WithSizeClasses(PoolAllocator::FitSizeClasses(histogram, 4)).Build());
+		EXPECT_EQ(allocator.GetPoolIndex(96), 1);
+		EXPECT_EQ(allocator.GetPoolIndex(Details::MaxPoolSize), 3);
+	}
+
+	TEST_F(PoolAllocatorTests, MemoryBudgetThrowsWhenExceeded)
+	{
+		constexpr std::size_t size = 256;
+		PoolAllocator allocator(PoolAllocatorConfiguration::Builder().WithMemoryBudget(16 * size).Build());
+
+		std::vector<void*> pointers;
+		for (int i = 0; i < 16; ++i)
+		{
+			pointers.push_back(allocator.Allocate(size));
+		}
+		EXPECT_THROW(static_cast<void>(allocator.Allocate(size)), MemoryBudgetExceededError);
+		EXPECT_THROW(static_cast<void>(allocator.Allocate(20000)), MemoryBudgetExceededError);
+		EXPECT_EQ(allocator.GetStats().budgetUsedBytes, 16 * size) << "A refused allocation gives its draw back";
+		EXPECT_FALSE(allocator.IsOverBudget());
+
+		allocator.Deallocate(pointers.back(), size);
+		pointers.back() = allocator.Allocate(size);
+
+		for (void* ptr : pointers)
+		{
+			allocator.Deallocate(ptr, size);
+		}
+		EXPECT_LE(allocator.GetStats().budgetUsedBytes, 2 * size) << "Only a step of credit stays with the thread";
+	}
+
+#if TASKKIT_HAS_MMAP
+	TEST_F(PoolAllocatorTests, MemoryBudgetIsReturnedWhenAllocationFails)
+	{
+		PoolAllocator allocator(PoolAllocatorConfiguration::Builder()
+			.WithMappedAllocationThreshold(16 * 1024)
+			.WithMemoryBudget(SIZE_MAX / 2)
+			.Build());
+
+		// Beyond any address space, so the mapping fails after the budget was charged.
+		EXPECT_THROW(static_cast<void>(allocator.Allocate(std::size_t{1} << 60)), std::bad_alloc);
+		EXPECT_LE(allocator.GetStats().budgetUsedBytes, PoolAllocator::MaxBudgetStepSize);
+		EXPECT_EQ(allocator.GetStats().largeAllocations, 0u);
+	}
+#endif
+
+	TEST_F(PoolAllocatorTests, MemoryBudgetHookLetsAllocationsThrough)
+	{
+		constexpr std::size_t size = 256;
+		std::vector<std::pair<std::size_t, std::size_t>> calls;
+		PoolAllocator allocator(PoolAllocatorConfiguration::Builder()
+			.WithMemoryBudget(4 * size, MemoryBudgetPolicy::Hook)
+			.WithMemoryBudgetHook(&calls, [](void* context, std::size_t requestedBytes, std::size_t usedBytes)
+			{
+				static_cast<std::vector<std::pair<std::size_t, std::size_t>>*>(context)->emplace_back(requestedBytes, usedBytes);
+			})
+			.Build());
+
+		std::vector<void*> pointers;
+		for (int i = 0; i < 6; ++i)
+		{
+			pointers.push_back(allocator.Allocate(size));
+		}
+		ASSERT_EQ(calls.size(), 2u);
+		EXPECT_EQ(calls[0], std::make_pair(size, 4 * size));
+		EXPECT_EQ(calls[1], std::make_pair(size, 5 * size));
+		EXPECT_TRUE(allocator.IsOverBudget());
+
+		for (void* ptr : pointers)
+		{
+			allocator.Deallocate(ptr, size);
+		}
+		EXPECT_FALSE(allocator.IsOverBudget());
+	}
+
+	TEST_F(PoolAllocatorTests, MemoryBudgetGateWakesWaitersOnceFreed)
+	{
+		constexpr std::size_t size = 256;
+		PoolAllocator allocator(PoolAllocatorConfiguration::Builder().WithMemoryBudget(4 * size, MemoryBudgetPolicy::Gate).Build());
+
+		struct CountingWaiter : PoolAllocator::BudgetWaiter
+		{
+			int wakeCount = 0;
+		};
+		CountingWaiter waiter;
+		waiter.wake = [](PoolAllocator::BudgetWaiter* self) { ++static_cast<CountingWaiter*>(self)->wakeCount; };
+		EXPECT_FALSE(allocator.WaitForBudget(waiter)) << "Nothing to wait for within budget";
+
+		std::vector<void*> pointers;
+		for (int i = 0; i < 6; ++i)
+		{
+			pointers.push_back(allocator.Allocate(size));
+		}
+		ASSERT_TRUE(allocator.IsOverBudget());
+		ASSERT_TRUE(allocator.WaitForBudget(waiter));
+
+		CountingWaiter cancelled;
+		ASSERT_TRUE(allocator.WaitForBudget(cancelled));
+		EXPECT_TRUE(allocator.CancelBudgetWait(cancelled));
+
+		// Frees on another thread return budget through that thread's credit.
+		std::thread otherThread([&]()
+		{
+			while (!pointers.empty() && waiter.wakeCount == 0)
+			{
+				allocator.Deallocate(pointers.back(), size);
+				pointers.pop_back();
+			}
+		});
+		otherThread.join();
+		EXPECT_EQ(waiter.wakeCount, 1);
+		EXPECT_FALSE(allocator.IsOverBudget());
+		EXPECT_FALSE(allocator.CancelBudgetWait(waiter)) << "A woken waiter is already unlinked";
+
+		for (void* ptr : pointers)
+		{
+			allocator.Deallocate(ptr, size);
+		}
+	}
+
 	TEST_F(PoolAllocatorTests, LargeAllocation)
 	{
 		constexpr std::size_t largeSize = 16384;
@@ -45,6 +621,81 @@ namespace TKit::Tests
 		allocator_.Deallocate(ptr, largeSize);
 	}
 
+	TEST_F(PoolAllocatorTests, LargeFramesAreCachedPerBucket)
+	{
+		void* ptr = allocator_.Allocate(20000);
+		std::memset(ptr, 0xAB, 20000);
+		allocator_.Deallocate(ptr, 20000);
+
+		void* sameBucket = allocator_.Allocate(30000);
+		EXPECT_EQ(sameBucket, ptr) << "Both sizes round up to the 32 KiB bucket";
+		std::memset(sameBucket, 0xCD, 30000);
+
+		void* otherBucket = allocator_.Allocate(10000);
+		EXPECT_NE(otherBucket, ptr);
+
+		allocator_.Deallocate(sameBucket, 30000);
+		allocator_.Deallocate(otherBucket, 10000);
+		EXPECT_EQ(allocator_.Trim(), 32u * 1024 + 16u * 1024) << "Trim should release the cached blocks";
+	}
+
+	TEST_F(PoolAllocatorTests, LargeFramesAboveCacheLimitAreNotCached)
+	{
+		PoolAllocator allocator(PoolAllocatorConfiguration::Builder()
+			.WithLargeCache(32 * 1024, 1)
+			.WithMappedAllocationThreshold(128 * 1024)
+			.Build());
+
+		std::vector<void*> pointers;
+		for (const std::size_t size : { std::size_t{20000}, std::size_t{20000}, std::size_t{40000}, std::size_t{300000} })
+		{
+			void* ptr = allocator.Allocate(size);
+			EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % alignof(std::max_align_t), 0u);
+			std::memset(ptr, 0xAB, size);
+			pointers.push_back(ptr);
+		}
+		for (void* ptr : pointers)
+		{
+			allocator.Deallocate(ptr, 0);
+		}
+
+		EXPECT_EQ(allocator.Trim(), 32u * 1024) << "Only one block fits the bucket depth, and larger ones are freed at once";
+	}
+
+#if TASKKIT_HAS_MMAP && defined(__linux__)
+	TEST_F(PoolAllocatorTests, MappedFramesAreUnmappedWhole)
+	{
+		// Address space of the process, in pages.
+		const auto getMappedPages = []()
+		{
+			std::size_t pages = 0;
+			std::ifstream("/proc/self/statm") >> pages;
+			return pages;
+		};
+
+		PoolAllocator allocator(PoolAllocatorConfiguration::Builder()
+			.WithLargeCache(0, 0)
+			.WithMappedAllocationThreshold(16 * 1024)
+			.Build());
+
+		constexpr std::size_t size = 100000;
+		constexpr std::size_t cycleCount = 1000;
+		const auto pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+		allocator.Deallocate(allocator.Allocate(size), size);
+		const std::size_t mappedPages = getMappedPages();
+		for (std::size_t i = 0; i < cycleCount; ++i)
+		{
+			void* ptr = allocator.Allocate(size);
+			std::memset(ptr, 0xAB, size);
+			allocator.Deallocate(ptr, size);
+		}
+
+		// Leaking even one page per cycle would show; a whole mapping's worth is allowed for unrelated growth.
+		EXPECT_LT((getMappedPages() - mappedPages) * pageSize, 2 * (size + PoolAllocator::SlabSize))
+			<< "Freeing a mapped frame should release its whole mapping";
+	}
+#endif
+
 	TEST_F(PoolAllocatorTests, SlabAllocation)
 	{
 		std::vector<void*> pointers;
@@ -218,6 +869,30 @@ namespace TKit::Tests
 		EXPECT_EQ(deallocCount.load(), numIterations);
 	}
 
+	TEST_F(PoolAllocatorTests, FindPoolIndexPicksSmallestFittingClass)
+	{
+		const auto& sizes = PoolAllocator::PoolSizes;
+
+		EXPECT_EQ(PoolAllocator::FindPoolIndex(0), 0);
+		EXPECT_EQ(PoolAllocator::FindPoolIndex(sizes.back() + 1), -1);
+
+		for (std::size_t size = 1; size <= sizes.back(); ++size)
+		{
+			const int index = PoolAllocator::FindPoolIndex(size);
+			ASSERT_GE(index, 0);
+			EXPECT_GE(sizes[index], size);
+			if (index > 0)
+			{
+				EXPECT_LT(sizes[index - 1], size);
+			}
+
+			// 16-byte spacing for small sizes, quarter powers of two above.
+			EXPECT_LE(sizes[index] - size, std::max<std::size_t>(15, sizes[index] / 5));
+		}
+
+		EXPECT_EQ(sizes[PoolAllocator::FindPoolIndex(130)], 160u);
+	}
+
 	TEST_F(PoolAllocatorTests, MultiplePoolSizes)
 	{
 		std::vector<std::pair<void*, std::size_t>> allocations;
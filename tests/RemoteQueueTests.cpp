@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "details/RemoteQueue.h"
+
+namespace TKit::Tests
+{
+	class RemoteQueueTests : public ::testing::Test
+	{
+	protected:
+		static constexpr std::size_t Capacity = 8;
+		RemoteQueue<std::size_t> queue_{Capacity};
+	};
+
+	TEST_F(RemoteQueueTests, DrainsInPushOrder)
+	{
+		EXPECT_TRUE(queue_.IsEmpty());
+
+		for (std::size_t i = 0; i < Capacity; ++i)
+		{
+			queue_.Push(i);
+		}
+		EXPECT_EQ(queue_.GetApproximateSize(), Capacity);
+
+		std::vector<std::size_t> drained;
+		EXPECT_EQ(queue_.Drain([&drained](std::size_t value) { drained.push_back(value); }), Capacity);
+
+		for (std::size_t i = 0; i < Capacity; ++i)
+		{
+			EXPECT_EQ(drained[i], i);
+		}
+		EXPECT_TRUE(queue_.IsEmpty());
+	}
+
+	TEST_F(RemoteQueueTests, OverflowKeepsEveryEntry)
+	{
+		constexpr std::size_t count = Capacity * 4;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			queue_.Push(i);
+		}
+		EXPECT_EQ(queue_.GetApproximateSize(), count);
+
+		std::vector<std::size_t> drained;
+		EXPECT_EQ(queue_.Drain([&drained](std::size_t value) { drained.push_back(value); }), count);
+
+		// Overflow entries come after the ring but keep their own push order.
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			EXPECT_EQ(drained[i], i);
+		}
+		EXPECT_TRUE(queue_.IsEmpty());
+	}
+
+	TEST_F(RemoteQueueTests, ConcurrentProducersAndConsumers)
+	{
+		constexpr std::size_t producerCount = 4;
+		constexpr std::size_t valuesPerProducer = 10000;
+
+		std::vector<std::atomic<int>> seen(producerCount * valuesPerProducer);
+		std::atomic<std::size_t> drainedCount{0};
+		std::atomic<bool> producing{true};
+
+		auto consume = [&]()
+		{
+			while (producing.load(std::memory_order_acquire) || !queue_.IsEmpty())
+			{
+				drainedCount.fetch_add(queue_.Drain([&seen](std::size_t value)
+				{
+					seen[value].fetch_add(1, std::memory_order_relaxed);
+				}), std::memory_order_relaxed);
+			}
+		};
+
+		std::thread consumer1(consume);
+		std::thread consumer2(consume);
+
+		std::vector<std::thread> producers;
+		for (std::size_t p = 0; p < producerCount; ++p)
+		{
+			producers.emplace_back([this, p]()
+			{
+				for (std::size_t i = 0; i < valuesPerProducer; ++i)
+				{
+					queue_.Push(p * valuesPerProducer + i);
+				}
+			});
+		}
+
+		for (auto& producer : producers)
+		{
+			producer.join();
+		}
+		producing.store(false, std::memory_order_release);
+		consumer1.join();
+		consumer2.join();
+
+		EXPECT_EQ(drainedCount.load(), producerCount * valuesPerProducer);
+		for (const auto& count : seen)
+		{
+			EXPECT_EQ(count.load(), 1);
+		}
+	}
+}
@@ -0,0 +1,267 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <thread>
+#include <vector>
+#include "details/TaskScheduler.h"
+
+namespace TKit::Tests
+{
+	class TaskSchedulerTests : public ::testing::Test
+	{
+	protected:
+		struct Counter
+		{
+			struct promise_type
+			{
+				Counter get_return_object() { return Counter{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+				std::suspend_always initial_suspend() noexcept { return {}; }
+				std::suspend_always final_suspend() noexcept { return {}; }
+				void return_void() {}
+				void unhandled_exception() { std::terminate(); }
+			};
+
+			std::coroutine_handle<promise_type> handle;
+		};
+
+		// Each resume runs one iteration, so the same suspended frame can be queued any number of times.
+		static Counter Count(std::size_t& resumeCount)
+		{
+			while (true)
+			{
+				++resumeCount;
+				co_await std::suspend_always{};
+			}
+		}
+
+		static Counter Record(std::vector<int>& order, int id)
+		{
+			while (true)
+			{
+				order.push_back(id);
+				co_await std::suspend_always{};
+			}
+		}
+
+		static constexpr std::size_t ReservedTaskCount = 16;
+		TaskScheduler scheduler_{ReservedTaskCount};
+	};
+
+	TEST_F(TaskSchedulerTests, PendingCountTracksLocalSchedules)
+	{
+		std::size_t resumeCount = 0;
+		const Counter counter = Count(resumeCount);
+
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 0u);
+		scheduler_.Schedule(counter.handle);
+		scheduler_.Schedule(counter.handle);
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 2u);
+
+		scheduler_.Update();
+		EXPECT_EQ(resumeCount, 2u);
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 0u);
+
+		counter.handle.destroy();
+	}
+
+	TEST_F(TaskSchedulerTests, PendingCountTracksRemoteSchedulesBeyondReservation)
+	{
+		std::size_t resumeCount = 0;
+		const Counter counter = Count(resumeCount);
+
+		constexpr std::size_t remoteCount = ReservedTaskCount * 8;
+		std::thread producer([this, &counter]()
+		{
+			for (std::size_t i = 0; i < remoteCount; ++i)
+			{
+				scheduler_.Schedule(counter.handle);
+			}
+		});
+		producer.join();
+
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), remoteCount);
+
+		scheduler_.Update();
+		EXPECT_EQ(resumeCount, remoteCount);
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 0u);
+
+		counter.handle.destroy();
+	}
+
+	TEST_F(TaskSchedulerTests, PendingCountTracksTimers)
+	{
+		std::size_t resumeCount = 0;
+		const Counter counter = Count(resumeCount);
+
+		TaskScheduler::Timer expired(TaskScheduler::Clock::now(), counter.handle);
+		TaskScheduler::Timer future(TaskScheduler::Clock::now() + std::chrono::hours(1), counter.handle);
+		scheduler_.ScheduleTimer(expired);
+		scheduler_.ScheduleTimer(future);
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 2u);
+
+		scheduler_.Update();
+		EXPECT_EQ(resumeCount, 1u);
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 1u);
+
+		scheduler_.CancelTimer(future);
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 0u);
+
+		counter.handle.destroy();
+	}
+
+	TEST_F(TaskSchedulerTests, UpdateForDefersRemainderInOrder)
+	{
+		std::vector<int> order;
+		const Counter a = Record(order, 0);
+		const Counter b = Record(order, 1);
+		const Counter c = Record(order, 2);
+		const Counter d = Record(order, 3);
+
+		scheduler_.Schedule(a.handle);
+		scheduler_.Schedule(b.handle);
+		scheduler_.Schedule(c.handle);
+
+		// A zero budget still makes progress one handle at a time.
+		EXPECT_EQ(scheduler_.UpdateFor(std::chrono::nanoseconds::zero()), 2u);
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 2u);
+
+		scheduler_.Schedule(d.handle);
+		EXPECT_EQ(scheduler_.UpdateFor(std::chrono::nanoseconds::zero()), 2u);
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 2u);
+
+		EXPECT_EQ(scheduler_.UpdateFor(std::chrono::seconds(10)), 0u);
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 0u);
+		EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3}));
+
+		for (const Counter& counter : { a, b, c, d })
+		{
+			counter.handle.destroy();
+		}
+	}
+
+	TEST_F(TaskSchedulerTests, UpdateRunsCarriedOverHandlesFirst)
+	{
+		std::vector<int> order;
+		const Counter a = Record(order, 0);
+		const Counter b = Record(order, 1);
+		const Counter c = Record(order, 2);
+
+		scheduler_.Schedule(a.handle);
+		scheduler_.Schedule(b.handle);
+		EXPECT_EQ(scheduler_.UpdateFor(std::chrono::nanoseconds::zero()), 1u);
+
+		scheduler_.Schedule(c.handle);
+		scheduler_.Update();
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 0u);
+		EXPECT_EQ(order, (std::vector<int>{0, 1, 2}));
+
+		for (const Counter& counter : { a, b, c })
+		{
+			counter.handle.destroy();
+		}
+	}
+
+	TEST_F(TaskSchedulerTests, UpdateDrainsHigherLanesFirst)
+	{
+		std::vector<int> order;
+		const Counter low = Record(order, 2);
+		const Counter normal = Record(order, 1);
+		const Counter high = Record(order, 0);
+
+		scheduler_.Schedule(low.handle, TaskPriority::Low);
+		scheduler_.Schedule(normal.handle);
+		scheduler_.Schedule(high.handle, TaskPriority::High);
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 3u);
+
+		scheduler_.Update();
+		EXPECT_EQ(order, (std::vector<int>{0, 1, 2}));
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 0u);
+
+		for (const Counter& counter : { low, normal, high })
+		{
+			counter.handle.destroy();
+		}
+	}
+
+	TEST_F(TaskSchedulerTests, RescheduleInheritsCurrentLane)
+	{
+		std::vector<int> order;
+		const Counter inherited = Record(order, 2);
+		const Counter normal = Record(order, 1);
+
+		auto reschedule = [](TaskScheduler& scheduler, std::coroutine_handle<> target) -> Counter
+		{
+			while (true)
+			{
+				scheduler.Schedule(target);
+				co_await std::suspend_always{};
+			}
+		};
+		const Counter rescheduler = reschedule(scheduler_, inherited.handle);
+
+		scheduler_.Schedule(rescheduler.handle, TaskPriority::Low);
+		scheduler_.Update();
+		EXPECT_TRUE(order.empty());
+		EXPECT_EQ(scheduler_.GetCurrentPriority(), TaskPriority::Normal);
+
+		// Scheduled from the Low lane, so it runs after a Normal handle queued later.
+		scheduler_.Schedule(normal.handle);
+		scheduler_.Update();
+		EXPECT_EQ(order, (std::vector<int>{1, 2}));
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 0u);
+
+		for (const Counter& counter : { inherited, normal, rescheduler })
+		{
+			counter.handle.destroy();
+		}
+	}
+
+	TEST_F(TaskSchedulerTests, StarvedLaneStillMakesProgress)
+	{
+		std::vector<int> order;
+		const Counter high = Record(order, 0);
+		const Counter low = Record(order, 1);
+
+		scheduler_.Schedule(low.handle, TaskPriority::Low);
+
+		// Keep the High lane busy so a zero budget never reaches Low in priority order.
+		bool lowResumed = false;
+		for (std::size_t update = 0; update <= TaskScheduler::LaneStarvationLimit && !lowResumed; ++update)
+		{
+			scheduler_.Schedule(high.handle, TaskPriority::High);
+			scheduler_.UpdateFor(std::chrono::nanoseconds::zero());
+			lowResumed = std::find(order.begin(), order.end(), 1) != order.end();
+		}
+		EXPECT_TRUE(lowResumed);
+
+		scheduler_.Update();
+		EXPECT_EQ(scheduler_.GetPendingTaskCount(), 0u);
+
+		for (const Counter& counter : { high, low })
+		{
+			counter.handle.destroy();
+		}
+	}
+
+	TEST_F(TaskSchedulerTests, UpdateFlushesAllocator)
+	{
+		std::size_t flushCount = 0;
+		TaskScheduler scheduler(ReservedTaskCount, std::thread::id{}, TaskAllocator{
+			&flushCount, nullptr, nullptr,
+			[](void* context) { ++*static_cast<std::size_t*>(context); }
+		});
+
+		std::size_t resumeCount = 0;
+		const Counter counter = Count(resumeCount);
+		scheduler.Schedule(counter.handle);
+
+		scheduler.Update();
+		EXPECT_EQ(flushCount, 1u);
+		scheduler.UpdateFor(std::chrono::nanoseconds::zero());
+		EXPECT_EQ(flushCount, 2u);
+
+		counter.handle.destroy();
+	}
+}
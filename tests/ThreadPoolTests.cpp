@@ -1,10 +1,12 @@
 #include <gtest/gtest.h>
 #include <atomic>
+#include <chrono>
 #include <latch>
 #include <thread>
 #include <vector>
 #include "details/ThreadPool.h"
 #include "details/TaskSchedulerManager.h"
+#include "TaskKit.h"
 
 namespace TKit::Tests
 {
@@ -256,4 +258,190 @@ namespace TKit::Tests
 
 		latch.wait();
 	}
+
+	TEST_F(ThreadPoolTests, IdleWorkerStealsFromBlockedWorker)
+	{
+		ThreadPool pool(*schedulerManager_, 2);
+
+		constexpr int shortTaskCount = 64;
+		std::atomic<int> completedShortTasks{0};
+		std::atomic<bool> blockerFinished{false};
+		std::atomic<bool> shortTasksCompletedWhileBlocked{false};
+
+		auto makeShortTask = [](std::atomic<int>* completed) -> Task
+		{
+			completed->fetch_add(1, std::memory_order_acq_rel);
+			co_return;
+		};
+
+		// The short tasks land on the blocker's own deque, so only a thief can run them.
+		auto makeBlocker = [&]() -> Task
+		{
+			for (int i = 0; i < shortTaskCount; ++i)
+			{
+				pool.Schedule(makeShortTask(&completedShortTasks).handle);
+			}
+
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+			while (completedShortTasks.load(std::memory_order_acquire) < shortTaskCount &&
+			       std::chrono::steady_clock::now() < deadline)
+			{
+				std::this_thread::yield();
+			}
+			shortTasksCompletedWhileBlocked.store(
+				completedShortTasks.load(std::memory_order_acquire) == shortTaskCount,
+				std::memory_order_release);
+			blockerFinished.store(true, std::memory_order_release);
+			co_return;
+		};
+
+		pool.Schedule(makeBlocker().handle);
+
+		while (!blockerFinished.load(std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+
+		EXPECT_TRUE(shortTasksCompletedWhileBlocked.load())
+			<< "Work queued behind a blocked worker should be stolen by the idle one";
+		EXPECT_GT(pool.GetStats().stealCount, 0u);
+	}
+
+	TEST_F(ThreadPoolTests, WorkScheduledFromWorkerStaysLocal)
+	{
+		ThreadPool pool(*schedulerManager_, 1);
+
+		std::latch latch{1};
+		std::thread::id parentThreadId;
+		std::thread::id childThreadId;
+
+		auto makeChild = [](std::thread::id* threadId, std::latch* l) -> Task
+		{
+			*threadId = std::this_thread::get_id();
+			l->count_down();
+			co_return;
+		};
+
+		auto makeParent = [&makeChild, &pool](std::thread::id* parentId, std::thread::id* childId, std::latch* l) -> Task
+		{
+			*parentId = std::this_thread::get_id();
+			pool.Schedule(makeChild(childId, l).handle);
+			co_return;
+		};
+
+		pool.Schedule(makeParent(&parentThreadId, &childThreadId, &latch).handle);
+		latch.wait();
+
+		EXPECT_EQ(parentThreadId, childThreadId);
+		EXPECT_EQ(pool.GetStats().stealCount, 0u);
+	}
+
+	TEST_F(ThreadPoolTests, ParkedWorkersWakeForEachSubmission)
+	{
+		// No spinning or yielding, so every worker parks as soon as it runs out of work.
+		ThreadPool pool(*schedulerManager_, 2, 100, 0, 0);
+
+		auto makeTask = [](std::latch* l) -> Task
+		{
+			l->count_down();
+			co_return;
+		};
+
+		for (int round = 0; round < 20; ++round)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+			std::latch latch{1};
+			auto task = makeTask(&latch);
+			pool.Schedule(round % 2 == 0 ? 0 : 1, task.handle);
+			latch.wait();
+		}
+
+		std::latch latch{1};
+		auto task = makeTask(&latch);
+		pool.Schedule(task.handle);
+		latch.wait();
+	}
+
+	TEST_F(ThreadPoolTests, ExternalSubmissionToBusyWorkerWakesParkedSibling)
+	{
+		// No spinning or yielding, so the idle worker is parked when the submission arrives.
+		ThreadPool pool(*schedulerManager_, 2, 100, 0, 0);
+
+		std::atomic<bool> blockerStarted{false};
+		std::atomic<bool> releaseBlocker{false};
+		auto makeBlocker = [](std::atomic<bool>* started, std::atomic<bool>* release) -> Task
+		{
+			started->store(true, std::memory_order_release);
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+			while (!release->load(std::memory_order_acquire) && std::chrono::steady_clock::now() < deadline)
+			{
+				std::this_thread::yield();
+			}
+			co_return;
+		};
+		auto makeTask = [](std::latch* l) -> Task
+		{
+			l->count_down();
+			co_return;
+		};
+
+		// Pinned, so the round-robin cursor still points at the blocked worker for the next submission.
+		pool.Schedule(0, makeBlocker(&blockerStarted, &releaseBlocker).handle);
+		while (!blockerStarted.load(std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+		std::latch latch{1};
+		pool.Schedule(makeTask(&latch).handle);
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+		while (!latch.try_wait() && std::chrono::steady_clock::now() < deadline)
+		{
+			std::this_thread::yield();
+		}
+		EXPECT_TRUE(latch.try_wait()) << "The parked worker should take work queued behind the busy one";
+
+		releaseBlocker.store(true, std::memory_order_release);
+		latch.wait();
+	}
+
+	TEST(ThreadPoolStatsTests, TaskSystemReportsSharedPoolSteals)
+	{
+		TaskSystem::Initialize(TaskSystemConfiguration::Builder().WithThreadPoolSize(2).Build());
+		EXPECT_EQ(TaskSystem::GetThreadPoolStats().stealCount, 0u);
+
+		constexpr int childCount = 8;
+		std::atomic<int> completedChildren{0};
+		std::latch latch{1};
+		auto child = [&]() -> TKit::Task<>
+		{
+			co_await SwitchToThreadPool();
+			completedChildren.fetch_add(1, std::memory_order_release);
+		};
+		auto parent = [&]() -> TKit::Task<>
+		{
+			co_await SwitchToThreadPool();
+
+			// The children queue on this worker, which stays busy until the other worker has stolen them.
+			for (int i = 0; i < childCount; ++i)
+			{
+				child().Forget();
+			}
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+			while (completedChildren.load(std::memory_order_acquire) < childCount && std::chrono::steady_clock::now() < deadline)
+			{
+				std::this_thread::yield();
+			}
+			latch.count_down();
+		};
+
+		parent().Forget();
+		latch.wait();
+
+		EXPECT_EQ(completedChildren.load(), childCount);
+		EXPECT_GT(TaskSystem::GetThreadPoolStats().stealCount, 0u);
+		TaskSystem::Shutdown();
+	}
 }
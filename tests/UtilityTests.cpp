@@ -45,6 +45,78 @@ namespace TKit::Tests
 		EXPECT_EQ(counter, 2);
 	}
 
+	TEST_F(UtilityTests, WaitForSleepsWithoutPolling)
+	{
+		bool completed = false;
+
+		auto task = [&]() -> Task<>
+		{
+			co_await WaitFor(50ms);
+			completed = true;
+			co_return;
+		};
+
+		const auto start = TestClock::now();
+		task().Forget();
+		EXPECT_EQ(TaskSystem::GetPendingTaskCount(GetSchedulerId()), 1u);
+
+		RunScheduler(10);
+		EXPECT_FALSE(completed);
+		EXPECT_EQ(TaskSystem::GetPendingTaskCount(GetSchedulerId()), 1u);
+
+		RunSchedulerFor(start, 60ms);
+		EXPECT_TRUE(completed);
+	}
+
+	TEST_F(UtilityTests, WaitUntilResumesInDeadlineOrder)
+	{
+		std::vector<int> order;
+		const auto now = TestClock::now();
+
+		auto task = [&](int id, TestClock::time_point target) -> Task<>
+		{
+			co_await WaitUntil(target);
+			order.push_back(id);
+			co_return;
+		};
+
+		task(3, now + 30ms).Forget();
+		task(1, now + 10ms).Forget();
+		task(2, now + 20ms).Forget();
+
+		std::this_thread::sleep_for(40ms);
+		RunScheduler(1);
+
+		EXPECT_EQ(order, (std::vector<int>{ 1, 2, 3 }));
+	}
+
+	TEST_F(UtilityTests, WaitForStopRequestWakesEarly)
+	{
+		std::stop_source stopSource;
+		bool stopped = false;
+
+		auto task = [&](std::stop_token stopToken) -> Task<>
+		{
+			try
+			{
+				co_await WaitFor(10s, stopToken);
+			}
+			catch (const OperationStoppedError&)
+			{
+				stopped = true;
+			}
+			co_return;
+		};
+
+		task(stopSource.get_token()).Forget();
+		RunScheduler(1);
+		EXPECT_FALSE(stopped);
+
+		stopSource.request_stop();
+		RunScheduler(1);
+		EXPECT_TRUE(stopped);
+	}
+
 	TEST_F(UtilityTests, WhenAllBasic)
 	{
 		int counter1 = 0;
@@ -332,6 +404,37 @@ namespace TKit::Tests
 		EXPECT_TRUE(completed);
 	}
 
+	TEST_F(UtilityTests, WhenAllVectorWithResults)
+	{
+		auto task = [&](int value, int frames) -> Task<int>
+		{
+			co_await DelayFrame(frames);
+			co_return value;
+		};
+
+		std::vector<int> results;
+
+		auto allTask = [&]() -> Task<>
+		{
+			std::vector<Task<int>> tasks;
+			for (int i = 0; i < 8; ++i)
+			{
+				tasks.push_back(task(i * 10, 8 - i));
+			}
+
+			results = co_await WhenAll(std::move(tasks));
+			co_return;
+		};
+
+		allTask().Forget();
+		EXPECT_TRUE(results.empty());
+
+		RunScheduler(8);
+
+		// Later tasks finish first, but results keep the order of the input.
+		EXPECT_EQ(results, (std::vector<int>{ 0, 10, 20, 30, 40, 50, 60, 70 }));
+	}
+
 	TEST_F(UtilityTests, WhenAllAllImmediateCompletion)
 	{
 		int counter1 = 0;
@@ -371,6 +474,78 @@ namespace TKit::Tests
 		EXPECT_TRUE(completed);
 	}
 
+	TEST_F(UtilityTests, WhenAllResumesOnceAfterOutOfOrderCompletion)
+	{
+		auto task1 = [&]() -> Task<int>
+		{
+			co_await DelayFrame(3);
+			co_return 1;
+		};
+
+		auto task2 = [&]() -> Task<int>
+		{
+			co_await DelayFrame(1);
+			co_return 2;
+		};
+
+		std::tuple<int, int> result;
+		int resumeCount = 0;
+
+		auto allTask = [&]() -> Task<>
+		{
+			result = co_await WhenAll(task1(), task2());
+			resumeCount++;
+			co_return;
+		};
+
+		allTask().Forget();
+
+		// task2 finishing first leaves only task1 queued; the waiting coroutine is not woken to look at it.
+		RunScheduler(1);
+		EXPECT_EQ(resumeCount, 0);
+		EXPECT_EQ(TaskSystem::GetPendingTaskCount(GetSchedulerId()), 1u);
+
+		RunScheduler(2);
+		EXPECT_EQ(resumeCount, 1);
+		EXPECT_EQ(std::get<0>(result), 1);
+		EXPECT_EQ(std::get<1>(result), 2);
+		EXPECT_EQ(TaskSystem::GetPendingTaskCount(GetSchedulerId()), 0u);
+	}
+
+	TEST_F(UtilityTests, WhenAllFansOutAcrossThreadPool)
+	{
+		constexpr int taskCount = 16;
+		std::latch latch{1};
+		std::atomic<int> finishedCount{0};
+		int observedCount = 0;
+
+		auto work = [&]() -> Task<>
+		{
+			co_await TKit::SwitchToThreadPool();
+			finishedCount.fetch_add(1, std::memory_order_relaxed);
+			co_return;
+		};
+
+		auto allTask = [&]() -> Task<>
+		{
+			std::vector<Task<>> tasks;
+			for (int i = 0; i < taskCount; ++i)
+			{
+				tasks.push_back(work());
+			}
+
+			co_await WhenAll(std::move(tasks));
+			observedCount = finishedCount.load(std::memory_order_relaxed);
+			latch.count_down();
+			co_return;
+		};
+
+		allTask().Forget();
+		latch.wait();
+
+		EXPECT_EQ(observedCount, taskCount);
+	}
+
 	TEST_F(UtilityTests, WhenAnyBasic)
 	{
 		int counter1 = 0;
@@ -612,6 +787,183 @@ namespace TKit::Tests
 		EXPECT_EQ(std::get<0>(result), 1);
 	}
 
+	TEST_F(UtilityTests, WhenAnySpanReturnsIndexAndResult)
+	{
+		auto task = [&](std::string value, int frames) -> Task<std::string>
+		{
+			co_await DelayFrame(frames);
+			co_return value;
+		};
+
+		std::pair<std::size_t, std::string> result{ 999, "" };
+
+		auto anyTask = [&]() -> Task<>
+		{
+			std::vector<Task<std::string>> tasks;
+			tasks.push_back(task("slow", 3));
+			tasks.push_back(task("fast", 1));
+			tasks.push_back(task("slower", 4));
+
+			result = co_await WhenAny(std::span(tasks));
+			co_return;
+		};
+
+		anyTask().Forget();
+		EXPECT_EQ(result.first, 999u);
+
+		RunScheduler(1);
+		EXPECT_EQ(result.first, 1u);
+		EXPECT_EQ(result.second, "fast");
+
+		// The losers keep running after the caller's vector is gone.
+		RunScheduler(3);
+	}
+
+	TEST_F(UtilityTests, WhenAnySpanAllVoid)
+	{
+		auto task = [&](int frames) -> Task<>
+		{
+			co_await DelayFrame(frames);
+			co_return;
+		};
+
+		std::size_t resultIndex = 999;
+
+		auto anyTask = [&]() -> Task<>
+		{
+			std::vector<Task<>> tasks;
+			tasks.push_back(task(2));
+			tasks.push_back(task(0));
+
+			resultIndex = co_await WhenAny(std::span(tasks));
+			co_return;
+		};
+
+		anyTask().Forget();
+		EXPECT_EQ(resultIndex, 1u);
+
+		RunScheduler(2);
+	}
+
+	TEST_F(UtilityTests, WhenAnyEmptySpanThrows)
+	{
+		bool threw = false;
+
+		auto anyTask = [&]() -> Task<>
+		{
+			std::vector<Task<int>> tasks;
+			try
+			{
+				static_cast<void>(co_await WhenAny(std::span(tasks)));
+			}
+			catch (const std::invalid_argument&)
+			{
+				threw = true;
+			}
+			co_return;
+		};
+
+		anyTask().Forget();
+		EXPECT_TRUE(threw) << "An empty span must fail instead of never completing";
+	}
+
+	TEST_F(UtilityTests, WhenAnyWaitsWithoutPolling)
+	{
+		auto task1 = [&]() -> Task<int>
+		{
+			co_await DelayFrame(2);
+			co_return 1;
+		};
+
+		auto task2 = [&]() -> Task<int>
+		{
+			co_await DelayFrame(3);
+			co_return 2;
+		};
+
+		std::variant<int, int> result;
+		bool resumed = false;
+
+		auto anyTask = [&]() -> Task<>
+		{
+			result = co_await WhenAny(task1(), task2());
+			resumed = true;
+			co_return;
+		};
+
+		anyTask().Forget();
+
+		// Only the two children are queued; the waiting coroutine does not reschedule itself.
+		EXPECT_EQ(TaskSystem::GetPendingTaskCount(GetSchedulerId()), 2u);
+
+		RunScheduler(1);
+		EXPECT_FALSE(resumed);
+		EXPECT_EQ(TaskSystem::GetPendingTaskCount(GetSchedulerId()), 2u);
+
+		// The winner resumes the waiting coroutine in the same update it completes in.
+		RunScheduler(1);
+		EXPECT_TRUE(resumed);
+		EXPECT_EQ(result.index(), 0);
+		EXPECT_EQ(TaskSystem::GetPendingTaskCount(GetSchedulerId()), 1u);
+
+		RunScheduler(1);
+	}
+
+	TEST_F(UtilityTests, WhenAnyPropagatesWinnerException)
+	{
+		auto task1 = [&]() -> Task<int>
+		{
+			co_yield {};
+			co_return 1;
+		};
+
+		auto task2 = [&]() -> Task<int>
+		{
+			throw std::runtime_error("failed");
+			co_return 2;
+		};
+
+		bool caught = false;
+
+		auto anyTask = [&]() -> Task<>
+		{
+			try
+			{
+				co_await WhenAny(task1(), task2());
+			}
+			catch (const std::runtime_error&)
+			{
+				caught = true;
+			}
+			co_return;
+		};
+
+		anyTask().Forget();
+		EXPECT_TRUE(caught);
+
+		RunScheduler(1);
+	}
+
+	TEST_F(UtilityTests, SwitchToPriorityMovesTaskToLane)
+	{
+		std::vector<int> order;
+
+		auto task = [&](int id, TaskPriority priority) -> Task<>
+		{
+			co_await SwitchToPriority(priority);
+			co_await DelayFrame(1);
+			order.push_back(id);
+			co_return;
+		};
+
+		task(2, TaskPriority::Low).Forget();
+		task(1, TaskPriority::Normal).Forget();
+		task(0, TaskPriority::High).Forget();
+
+		RunScheduler(2);
+		EXPECT_EQ(order, (std::vector<int>{0, 1, 2}));
+	}
+
 	TEST_F(UtilityTests, SwitchToThreadPool)
 	{
 		std::latch latch{1};